@@ -21,6 +21,10 @@ _start:
     ; Set up stack
     mov esp, stack_top
     
+    ; Save the multiboot magic and info pointer before cpuid clobbers them
+    mov [multiboot_magic], eax
+    mov [multiboot_info], ebx
+    
     ; Check if CPUID is supported
     call check_cpuid
     call check_long_mode
@@ -162,7 +166,10 @@ long_mode_start:
     ; Set up the stack pointer for C code
     mov rsp, stack_top
     
-    ; Call the C kernel main function
+    ; Call the C kernel main function with the multiboot magic and info
+    ; pointer (zero-extended into rdi and rsi)
+    mov edi, [multiboot_magic]
+    mov esi, [multiboot_info]
     call kernel_main
     
     ; If kernel_main returns, halt the system
@@ -212,16 +219,22 @@ process_switch_context:
     pop rax
     mov [rdi + 136], rax
     
-    ; Save CR3
-    mov rax, cr3
-    mov [rdi + 144], rax
+    ; CR3 is not saved: it belongs to the process's address space and
+    ; keeps its PCID no-flush bit, which reading CR3 would lose
 
 .load_new:
     ; Load new context from rsi
     
-    ; Restore CR3 first (if we were changing address spaces)
+    ; Switch address spaces only if the new one differs; bit 63 (keep the
+    ; PCID's TLB entries) never reads back from CR3
     mov rax, [rsi + 144]
+    mov rdx, rax
+    btr rdx, 63
+    mov rcx, cr3
+    cmp rdx, rcx
+    je .same_space
     mov cr3, rax
+.same_space:
     
     ; Restore RFLAGS
     mov rax, [rsi + 136]
@@ -257,7 +270,127 @@ process_switch_context:
     ; Jump to the new RIP
     ret
 
+; CPU exception and IRQ entry points. Each stub pushes a dummy error code
+; if the CPU does not push one, then the vector number, so every interrupt
+; reaches interrupt_dispatch with the same interrupt_frame_t layout.
+[EXTERN interrupt_dispatch]
+
+%macro ISR_NOERR 1
+isr_stub_%1:
+    push qword 0
+    push qword %1
+    jmp isr_common
+%endmacro
+
+%macro ISR_ERR 1
+isr_stub_%1:
+    push qword %1
+    jmp isr_common
+%endmacro
+
+ISR_NOERR 0
+ISR_NOERR 1
+ISR_NOERR 2
+ISR_NOERR 3
+ISR_NOERR 4
+ISR_NOERR 5
+ISR_NOERR 6
+ISR_NOERR 7
+ISR_ERR   8
+ISR_NOERR 9
+ISR_ERR   10
+ISR_ERR   11
+ISR_ERR   12
+ISR_ERR   13
+ISR_ERR   14
+ISR_NOERR 15
+ISR_NOERR 16
+ISR_ERR   17
+ISR_NOERR 18
+ISR_NOERR 19
+ISR_NOERR 20
+ISR_ERR   21
+ISR_NOERR 22
+ISR_NOERR 23
+ISR_NOERR 24
+ISR_NOERR 25
+ISR_NOERR 26
+ISR_NOERR 27
+ISR_NOERR 28
+ISR_ERR   29
+ISR_ERR   30
+ISR_NOERR 31
+
+; Hardware interrupts from the remapped PIC
+ISR_NOERR 32
+ISR_NOERR 33
+ISR_NOERR 34
+ISR_NOERR 35
+ISR_NOERR 36
+ISR_NOERR 37
+ISR_NOERR 38
+ISR_NOERR 39
+ISR_NOERR 40
+ISR_NOERR 41
+ISR_NOERR 42
+ISR_NOERR 43
+ISR_NOERR 44
+ISR_NOERR 45
+ISR_NOERR 46
+ISR_NOERR 47
+
+isr_common:
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push rbp
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+    
+    ; rdi = interrupt_frame_t*; the frame keeps rsp 16-byte aligned
+    mov rdi, rsp
+    cld
+    call interrupt_dispatch
+    
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rbp
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+    
+    ; Drop the vector number and error code
+    add rsp, 16
+    iretq
+
 section .rodata
+; Stub addresses for idt_init, indexed by vector
+global isr_stub_table
+isr_stub_table:
+%assign i 0
+%rep 48
+    dq isr_stub_%+i
+%assign i i + 1
+%endrep
+
 gdt64:
     dq 0 ; zero entry
 .code: equ $ - gdt64
@@ -275,6 +408,12 @@ p3_table:
 p2_table:
     resb 4096
     
+; Multiboot handoff values (eax and ebx at entry)
+multiboot_magic:
+    resd 1
+multiboot_info:
+    resd 1
+    
 align 16
     resb 16384      ; 16KB stack
 stack_top:
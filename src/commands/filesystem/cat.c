@@ -15,18 +15,20 @@ static int cmd_cat_main(int argc, char** argv) {
         return 1;
     }
     
-    char file_buffer[4096];
-    int size = fat16_read_file(argv[1], file_buffer, sizeof(file_buffer) - 1);
-    if (size > 0) {
-        file_buffer[size] = '\0';
-        terminal_writestring("File contents:\n");
-        terminal_writestring(file_buffer);
-        terminal_writestring("\n");
-        return 0;
-    } else {
+    // Map the file rather than copying it, so its size is not limited by
+    // a buffer; clusters are read as the output reaches them
+    int size = fat16_get_file_size(argv[1]);
+    const char* contents = (const char*)fat16_mmap(argv[1], 0);
+    if (size <= 0 || !contents) {
         terminal_writestring("File not found or read error\n");
         return 1;
     }
+    
+    terminal_writestring("File contents:\n");
+    terminal_write(contents, size);
+    terminal_writestring("\n");
+    fat16_munmap((void*)contents);
+    return 0;
 }
 
 REGISTER_COMMAND("cat", "Display file contents", cmd_cat_main)
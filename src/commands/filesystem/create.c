@@ -2,6 +2,7 @@
 #include "terminal.h"
 #include "fat16.h"
 #include "string.h"
+#include "memory.h"
 
 static int cmd_create_main(int argc, char** argv) {
     if (command_check_help_flag(argc, argv)) {
@@ -17,17 +18,16 @@ static int cmd_create_main(int argc, char** argv) {
     }
     
     // Combine all arguments after filename as content
-    char content_buffer[1024];
-    content_buffer[0] = '\0';
-    
-    for (int i = 2; i < argc; i++) {
-        if (i > 2) {
-            strcat(content_buffer, " ");
-        }
-        strcat(content_buffer, argv[i]);
+    char* content = command_join_args(argc, argv, 2);
+    if (!content) {
+        terminal_writestring("Out of memory\n");
+        return 1;
     }
     
-    if (fat16_create_file(argv[1], content_buffer, strlen(content_buffer))) {
+    int created = fat16_create_file(argv[1], content, strlen(content));
+    kfree(content);
+    
+    if (created) {
         terminal_writestring("File created successfully\n");
         return 0;
     } else {
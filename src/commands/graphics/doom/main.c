@@ -2,18 +2,18 @@
 #include "terminal.h"
 #include "vga.h"
 #include "keyboard.h"
+#include "mouse.h"
 #include "timer.h"
+#include "process.h"
 #include "memory.h"
 #include "memory_utils.h"
 #include "doom.h"
 #include "lolek.h"
 #include "string.h"  // Added for memcpy
-#include "mouse.h"
-#include "io.h"
 
 // FPS Control
 #define FPS 30
-#define TICKS_PER_FRAME (PIT_FREQ / FPS)
+#define FRAME_MS (1000 / FPS)
 
 // Movement speed
 #define MOVE_SPEED 0.10f
@@ -28,11 +28,10 @@ int cmd_doom_main(int argc, char** argv) {
         return 1;
     }
 
-    timer_init();
     math_init();
 
     // Allocate backbuffer
-    uint8_t* backbuffer = (uint8_t*)kmalloc(SCREEN_W * SCREEN_H);
+    uint8_t* backbuffer = (uint8_t*)kmalloc_aligned(SCREEN_W * SCREEN_H, MEMORY_CACHE_LINE_SIZE);
     if (!backbuffer) {
         terminal_writestring("Error: Failed to allocate backbuffer.\n");
         return 1;
@@ -58,15 +57,10 @@ int cmd_doom_main(int argc, char** argv) {
 
     
     while (running) {
-        uint16_t start_count = timer_read_count();
+        uint64_t frame_start = timer_ms();
 
         // Input handling - process all pending events
         while (keyboard_has_input()) {
-            // Check for mouse data
-            if (inb(0x64) & 0x20) {
-                 mouse_handle_byte(inb(0x60));
-                 continue;
-            }
             uint8_t scancode = keyboard_read_scancode();
             
             // ESC
@@ -118,27 +112,22 @@ int cmd_doom_main(int argc, char** argv) {
         // Render
         vga_state.framebuffer = backbuffer;
         raycast_render(&player);
+        mouse_update(1); // The frame covered the cursor
         
         // Flip buffer
         memcpy(vga_mem, backbuffer, SCREEN_W * SCREEN_H);
         vga_state.framebuffer = vga_mem;
 
         // Cap FPS
-        while (1) {
-            uint16_t current_count = timer_read_count();
-            uint16_t diff;
-            if (start_count >= current_count) {
-                diff = start_count - current_count;
-            } else {
-                diff = start_count + (65536 - current_count);
-            }
-            if (diff >= TICKS_PER_FRAME) break;
+        uint64_t elapsed = timer_ms() - frame_start;
+        if (elapsed < FRAME_MS) {
+            process_sleep(FRAME_MS - elapsed);
         }
     }
 
     // Cleanup
     vga_clear_screen(COLOR_BLACK);
-    kfree(backbuffer);
+    kfree_aligned(backbuffer);
     
     return 0;
 }
@@ -2,6 +2,7 @@
 #include "terminal.h"
 #include "vga.h"
 #include "string.h"
+#include "memory.h"
 
 static int cmd_draw_main(int argc, char** argv) {
     if (command_check_help_flag(argc, argv)) {
@@ -116,14 +117,14 @@ static int cmd_draw_main(int argc, char** argv) {
         int bg = atoi(argv[5]);
         
         // Combine remaining arguments as text
-        char text_buffer[256];
-        text_buffer[0] = '\0';
-        for (int i = 6; i < argc; i++) {
-            if (i > 6) strcat(text_buffer, " ");
-            strcat(text_buffer, argv[i]);
+        char* text = command_join_args(argc, argv, 6);
+        if (!text) {
+            terminal_writestring("Out of memory\n");
+            return 1;
         }
         
-        vga_draw_string(x, y, text_buffer, fg, bg);
+        vga_draw_string(x, y, text, fg, bg);
+        kfree(text);
         return 0;
     }
     
@@ -0,0 +1,99 @@
+#include "command.h"
+#include "terminal.h"
+#include "vga.h"
+#include "vmm.h"
+#include "memory.h"
+#include "memory_utils.h"
+#include "string.h"
+#include "clock.h"
+
+#define FBBENCH_FRAME_SIZE (VGA_GFX_WIDTH * VGA_GFX_HEIGHT)
+#define FBBENCH_DEFAULT_FRAMES 200
+
+// Average TSC cycles per 64000-byte flip with the window mapped with flags
+static uint64_t fbbench_run(const uint8_t* backbuffer, int frames, uint32_t flags) {
+    uint8_t* vga_mem = (uint8_t*)VGA_MEMORY;
+    
+    // Changing a page's memory type requires writing back cached lines
+    vmm_protect(VGA_MEMORY, VGA_MEMORY_SIZE, flags);
+    __asm__ volatile("wbinvd" : : : "memory");
+    
+    uint64_t start = clock_cycles();
+    for (int i = 0; i < frames; i++) {
+        memcpy(vga_mem, backbuffer, FBBENCH_FRAME_SIZE);
+    }
+    __asm__ volatile("sfence" : : : "memory");  // Drain write-combining buffers
+    uint64_t cycles = clock_cycles() - start;
+    
+    return cycles / frames;
+}
+
+static void fbbench_report(const char* label, uint64_t cycles) {
+    char buffer[32];
+    terminal_writestring(label);
+    uint32_to_string((uint32_t)cycles, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" cycles/flip, ");
+    uint32_to_string((uint32_t)(cycles ? (uint64_t)FBBENCH_FRAME_SIZE * 1000 / cycles : 0), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" bytes/kcycle\n");
+}
+
+static int cmd_fbbench_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv)) {
+        command_show_usage("fbbench", "[frames]");
+        terminal_writestring("Measure frame flip throughput into the VGA window,\n");
+        terminal_writestring("uncached (as the MTRRs leave it) and write-combining.\n");
+        return 0;
+    }
+    
+    // The mode 13h window overlaps font memory in text mode
+    if (!vga_state.graphics_mode) {
+        terminal_writestring("Error: Not in graphics mode. Run 'gfx 13h' first.\n");
+        return 1;
+    }
+    
+    int frames = argc >= 2 ? atoi(argv[1]) : FBBENCH_DEFAULT_FRAMES;
+    if (frames <= 0) {
+        frames = FBBENCH_DEFAULT_FRAMES;
+    }
+    
+    uint8_t* backbuffer = (uint8_t*)kmalloc_aligned(FBBENCH_FRAME_SIZE, MEMORY_CACHE_LINE_SIZE);
+    if (!backbuffer) {
+        terminal_writestring("Error: Failed to allocate backbuffer.\n");
+        return 1;
+    }
+    for (int i = 0; i < FBBENCH_FRAME_SIZE; i++) {
+        backbuffer[i] = (uint8_t)((i % VGA_GFX_WIDTH) ^ (i / VGA_GFX_WIDTH));
+    }
+    
+    // A plain mapping is uncached in effect: the MTRRs mark 0xA0000-0xBFFFF UC
+    uint64_t uc_cycles = fbbench_run(backbuffer, frames, VMM_MAP_WRITE);
+    uint64_t wc_cycles = fbbench_run(backbuffer, frames, VMM_MAP_WRITE | VMM_MAP_WRITECOMBINE);
+    kfree_aligned(backbuffer);
+    
+    // Leave the pattern from the last pass on screen and report below it
+    terminal_writestring("Frame flip benchmark (");
+    char buffer[32];
+    uint32_to_string(frames, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" frames)\n");
+    fbbench_report("  Uncached (MTRR):  ", uc_cycles);
+    fbbench_report("  Write-combining:  ", wc_cycles);
+    if (!vmm_write_combining()) {
+        terminal_writestring("  (no PAT: write-combining falls back to uncached)\n");
+    }
+    if (wc_cycles) {
+        uint32_t ratio = (uint32_t)(uc_cycles * 100 / wc_cycles);
+        terminal_writestring("  Speedup: ");
+        uint32_to_string(ratio / 100, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring(ratio % 100 < 10 ? ".0" : ".");
+        uint32_to_string(ratio % 100, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring("x\n");
+    }
+    return 0;
+}
+
+REGISTER_COMMAND("fbbench", "Benchmark framebuffer flip throughput", cmd_fbbench_main)
@@ -2,16 +2,16 @@
 #include "terminal.h"
 #include "vga.h"
 #include "keyboard.h"
+#include "mouse.h"
 #include "timer.h"
+#include "process.h"
 #include "memory.h"
 #include "memory_utils.h"
 #include "game.h"
-#include "mouse.h"
-#include "io.h"
 
-// PIT Constants for framerate
+// Frame pacing
 #define FPS 60
-#define TICKS_PER_FRAME (PIT_FREQ / FPS)
+#define FRAME_MS (1000 / FPS)
 
 int cmd_platformer_main(int argc, char** argv) {
     (void)argc;
@@ -22,10 +22,8 @@ int cmd_platformer_main(int argc, char** argv) {
         return 1;
     }
 
-    timer_init();
-
     // Allocate backbuffer for double buffering
-    uint8_t* backbuffer = (uint8_t*)kmalloc(SCREEN_WIDTH * SCREEN_HEIGHT);
+    uint8_t* backbuffer = (uint8_t*)kmalloc_aligned(SCREEN_WIDTH * SCREEN_HEIGHT, MEMORY_CACHE_LINE_SIZE);
     if (!backbuffer) {
         terminal_writestring("Error: Failed to allocate backbuffer.\n");
         return 1;
@@ -42,15 +40,10 @@ int cmd_platformer_main(int argc, char** argv) {
     int key_right = 0;
 
     while (running) {
-        uint16_t start_count = timer_read_count();
+        uint64_t frame_start = timer_ms();
 
         // Input handling
         while (keyboard_has_input()) {
-            // Check for mouse data
-            if (inb(0x64) & 0x20) {
-                 mouse_handle_byte(inb(0x60));
-                 continue;
-            }
             uint8_t scancode = keyboard_read_scancode();
             
             // Key Press (Make code)
@@ -85,6 +78,7 @@ int cmd_platformer_main(int argc, char** argv) {
         // Draw to backbuffer
         vga_state.framebuffer = backbuffer;
         draw_game(&player);
+        mouse_update(1); // The frame covered the cursor
         
         // Flip buffer (copy backbuffer to VGA memory)
         memcpy(vga_mem, backbuffer, SCREEN_WIDTH * SCREEN_HEIGHT);
@@ -93,15 +87,9 @@ int cmd_platformer_main(int argc, char** argv) {
         vga_state.framebuffer = vga_mem;
 
         // Cap to 60 FPS
-        while (1) {
-            uint16_t current_count = timer_read_count();
-            uint16_t diff;
-            if (start_count >= current_count) {
-                diff = start_count - current_count;
-            } else {
-                diff = start_count + (65536 - current_count);
-            }
-            if (diff >= TICKS_PER_FRAME) break;
+        uint64_t elapsed = timer_ms() - frame_start;
+        if (elapsed < FRAME_MS) {
+            process_sleep(FRAME_MS - elapsed);
         }
     }
 
@@ -109,7 +97,7 @@ int cmd_platformer_main(int argc, char** argv) {
     vga_clear_screen(COLOR_BLACK);
     
     // Free backbuffer
-    kfree(backbuffer);
+    kfree_aligned(backbuffer);
     
     return 0;
 }
@@ -0,0 +1,68 @@
+#include "command.h"
+#include "terminal.h"
+#include "shm.h"
+#include "string.h"
+
+static int cmd_shm_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv)) {
+        command_show_usage("shm", "[create <name> <kb> | write <name> <text> | read <name> | unmap <name>]");
+        terminal_writestring("Manage named shared memory objects from the shell process.\n");
+        terminal_writestring("Without arguments, list objects and the PIDs mapping them.\n");
+        return 0;
+    }
+    
+    if (argc < 2) {
+        shm_list();
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "create") == 0 && argc >= 4) {
+        int kb = atoi(argv[3]);
+        if (kb <= 0 || !shm_create(argv[2], (size_t)kb * 1024)) {
+            terminal_writestring("Failed to create shared memory object\n");
+            return 1;
+        }
+        terminal_writestring("Created shared memory object: ");
+        terminal_writestring(argv[2]);
+        terminal_writestring("\n");
+        return 0;
+    }
+    
+    if (argc < 3) {
+        terminal_writestring("Usage: shm [create <name> <kb> | write <name> <text> | read <name> | unmap <name>]\n");
+        return 1;
+    }
+    
+    // Maps the object into the shell if it is not mapped already
+    char* data = (char*)shm_map(argv[2]);
+    if (!data) {
+        terminal_writestring("Shared memory object not found: ");
+        terminal_writestring(argv[2]);
+        terminal_writestring("\n");
+        return 1;
+    }
+    
+    if (strcmp(argv[1], "write") == 0 && argc >= 4) {
+        // Objects are at least one page, far larger than a command line
+        strcpy(data, argv[3]);
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "read") == 0) {
+        terminal_writestring(data);
+        terminal_writestring("\n");
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "unmap") == 0) {
+        shm_unmap(data);
+        return 0;
+    }
+    
+    terminal_writestring("Unknown shm operation: ");
+    terminal_writestring(argv[1]);
+    terminal_writestring("\n");
+    return 1;
+}
+
+REGISTER_COMMAND("shm", "Manage shared memory objects", cmd_shm_main)
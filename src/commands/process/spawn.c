@@ -13,6 +13,13 @@ static void test_process_main(void* args) {
     terminal_writestring(name);
     terminal_writestring(" started\n");
     
+    // Write to process memory; in a clone this copies the shared page
+    char* scratch = (char*)proc_alloc(16);
+    if (scratch) {
+        strncpy(scratch, name, 15);
+        scratch[15] = '\0';
+    }
+    
     // Do some work
     for (int i = 0; i < 5; i++) {
         terminal_writestring(name);
@@ -40,24 +47,31 @@ static void test_process_main(void* args) {
 
 static int cmd_spawn_main(int argc, char** argv) {
     if (command_check_help_flag(argc, argv)) {
-        command_show_usage("spawn", "<name>");
+        command_show_usage("spawn", "[-c] <name>");
         terminal_writestring("Create a new test process with the given name.\n");
         terminal_writestring("The process will run in the background.\n");
+        terminal_writestring("  -c  Clone the shell's process memory copy-on-write\n");
         return 0;
     }
     
-    if (argc < 2) {
-        terminal_writestring("Usage: spawn <name>\n");
+    int clone = argc >= 3 && strcmp(argv[1], "-c") == 0;
+    if (argc < 2 || (argc >= 3 && !clone)) {
+        terminal_writestring("Usage: spawn [-c] <name>\n");
         return 1;
     }
     
     // Create a name for the test process
     static char process_name[64];
-    strncpy(process_name, argv[1], sizeof(process_name) - 1);
+    strncpy(process_name, argv[clone ? 2 : 1], sizeof(process_name) - 1);
     process_name[sizeof(process_name) - 1] = '\0';
     
-    process_t* proc = process_create(process_name, test_process_main, NULL,
-                                   PROCESS_PRIORITY_NORMAL, 8192);
+    process_t* proc;
+    if (clone) {
+        proc = process_clone(process_get_current(), process_name, test_process_main, NULL);
+    } else {
+        proc = process_create(process_name, test_process_main, NULL,
+                              PROCESS_PRIORITY_NORMAL, 8192);
+    }
     if (proc) {
         terminal_writestring("Created process: ");
         terminal_writestring(process_name);
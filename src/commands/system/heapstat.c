@@ -0,0 +1,46 @@
+#include "command.h"
+#include "terminal.h"
+#include "memory.h"
+#include "string.h"
+
+#define HEAPSTAT_DEFAULT_LIMIT 10
+
+static int cmd_heapstat_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv)) {
+        command_show_usage("heapstat", "[bytes|count|churn] [limit]");
+        terminal_writestring("Show the kmalloc call sites using the most memory.\n");
+        terminal_writestring("  bytes - sort by live bytes (default)\n");
+        terminal_writestring("  count - sort by number of allocations\n");
+        terminal_writestring("  churn - sort by number of allocations freed again\n");
+        terminal_writestring("Requires a kernel built with 'make MEMORY_PROFILE=1'.\n");
+        return 0;
+    }
+    
+    memory_profile_sort_t sort = MEMORY_PROFILE_BY_BYTES;
+    if (argc > 1) {
+        if (strcmp(argv[1], "bytes") == 0) {
+            sort = MEMORY_PROFILE_BY_BYTES;
+        } else if (strcmp(argv[1], "count") == 0) {
+            sort = MEMORY_PROFILE_BY_COUNT;
+        } else if (strcmp(argv[1], "churn") == 0) {
+            sort = MEMORY_PROFILE_BY_CHURN;
+        } else {
+            terminal_writestring("Usage: heapstat [bytes|count|churn] [limit]\n");
+            return 1;
+        }
+    }
+    
+    int limit = HEAPSTAT_DEFAULT_LIMIT;
+    if (argc > 2) {
+        limit = atoi(argv[2]);
+        if (limit <= 0) {
+            limit = HEAPSTAT_DEFAULT_LIMIT;
+        }
+    }
+    
+    terminal_writestring("=== Heap Call Sites ===\n");
+    memory_profile_print(sort, limit);
+    return 0;
+}
+
+REGISTER_COMMAND("heapstat", "Show heap usage by allocation site", cmd_heapstat_main)
@@ -1,19 +1,27 @@
 #include "command.h"
 #include "terminal.h"
 #include "ata.h"
+#include "string.h"
 
 static int cmd_lsdisks_main(int argc, char** argv) {
     ata_detect_disks();
     terminal_writestring("Detected disks:\n");
     for (int i = 0; i < ata_disk_count; i++) {
         if (ata_disks[i].present) {
+            char buffer[16];
             terminal_writestring("  ");
+            uint32_to_string(i, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring(": ");
             terminal_writestring(ata_disks[i].is_slave ? "Slave" : "Master");
             terminal_writestring(" on ");
             terminal_writestring((ata_disks[i].io_base == 0x1F0) ? "Primary" : "Secondary");
             terminal_writestring(": ");
             terminal_writestring(ata_disks[i].model);
-            terminal_writestring("\n");
+            terminal_writestring(" (");
+            uint32_to_string(ata_disks[i].sectors / (1024 * 1024 / ATA_SECTOR_SIZE), buffer);
+            terminal_writestring(buffer);
+            terminal_writestring(" MB)\n");
         }
     }
     if (ata_disk_count == 0) terminal_writestring("  (none)\n");
@@ -1,6 +1,9 @@
 #include "command.h"
 #include "terminal.h"
 #include "memory.h"
+#include "frame.h"
+#include "vmm.h"
+#include "swap.h"
 
 static int cmd_meminfo_main(int argc, char** argv) {
     if (command_check_help_flag(argc, argv)) {
@@ -10,6 +13,9 @@ static int cmd_meminfo_main(int argc, char** argv) {
     }
     
     memory_print_stats();
+    frame_print_stats();
+    vmm_print_stats();
+    swap_print_stats();
     return 0;
 }
 
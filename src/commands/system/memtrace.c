@@ -0,0 +1,103 @@
+#include "command.h"
+#include "terminal.h"
+#include "memory.h"
+#include "fat16.h"
+#include "string.h"
+
+static void memtrace_print_status(void) {
+    char buffer[32];
+    size_t size = memory_trace_size();
+    size_t count = size ? (size - sizeof(memory_trace_header_t)) / sizeof(memory_trace_entry_t) : 0;
+    
+    terminal_writestring("Tracing: ");
+    terminal_writestring(memory_trace_enabled() ? "on" : "off");
+    terminal_writestring("\nEntries: ");
+    uint32_to_string(count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" of ");
+    uint32_to_string(MEMORY_TRACE_ENTRIES, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring("\n");
+}
+
+// Write the recorded trace to a FAT16 file for tools/heapreplay
+static int memtrace_dump(const char* filename) {
+    int was_enabled = memory_trace_enabled();
+    memory_trace_stop();
+    
+    size_t size = memory_trace_size();
+    void* buffer = kmalloc(size);
+    if (!buffer) {
+        terminal_writestring("Out of memory\n");
+        return 1;
+    }
+    
+    size_t written = memory_trace_export(buffer, size);
+    int result = written && fat16_create_file(filename, buffer, written);
+    kfree(buffer);
+    
+    if (was_enabled) {
+        terminal_writestring("Tracing stopped.\n");
+    }
+    
+    if (!result) {
+        terminal_writestring("Failed to write trace file\n");
+        return 1;
+    }
+    
+    char size_str[16];
+    uint32_to_string(written, size_str);
+    terminal_writestring("Wrote ");
+    terminal_writestring(size_str);
+    terminal_writestring(" bytes to ");
+    terminal_writestring(filename);
+    terminal_writestring("\n");
+    return 0;
+}
+
+static int cmd_memtrace_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv) || argc < 2) {
+        command_show_usage("memtrace", "<start|stop|status|dump <file>>");
+        terminal_writestring("Record kmalloc/kfree calls for replay with tools/heapreplay.\n");
+        terminal_writestring("  start       - clear the trace and start recording\n");
+        terminal_writestring("  stop        - stop recording\n");
+        terminal_writestring("  status      - show whether recording and how many entries\n");
+        terminal_writestring("  dump <file> - stop recording and save the trace to a file\n");
+        return argc < 2 ? 1 : 0;
+    }
+    
+    if (!MEMORY_TRACE) {
+        terminal_writestring("Allocation tracing is disabled. Rebuild with 'make MEMORY_TRACE=1'.\n");
+        return 1;
+    }
+    
+    if (strcmp(argv[1], "start") == 0) {
+        memory_trace_start();
+        terminal_writestring("Tracing started.\n");
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "stop") == 0) {
+        memory_trace_stop();
+        terminal_writestring("Tracing stopped.\n");
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "status") == 0) {
+        memtrace_print_status();
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "dump") == 0) {
+        if (argc < 3) {
+            terminal_writestring("Usage: memtrace dump <file>\n");
+            return 1;
+        }
+        return memtrace_dump(argv[2]);
+    }
+    
+    terminal_writestring("Unknown subcommand. Use 'memtrace --help'.\n");
+    return 1;
+}
+
+REGISTER_COMMAND("memtrace", "Record heap calls for replay", cmd_memtrace_main)
@@ -0,0 +1,16 @@
+#include "command.h"
+#include "terminal.h"
+#include "slab.h"
+
+static int cmd_slabinfo_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv)) {
+        command_show_usage("slabinfo", "");
+        terminal_writestring("Display per-cache slab allocator statistics.\n");
+        return 0;
+    }
+    
+    kmem_cache_print_stats();
+    return 0;
+}
+
+REGISTER_COMMAND("slabinfo", "Show slab cache statistics", cmd_slabinfo_main)
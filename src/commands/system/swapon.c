@@ -0,0 +1,39 @@
+#include "command.h"
+#include "terminal.h"
+#include "ata.h"
+#include "swap.h"
+#include "string.h"
+
+static int cmd_swapon_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv)) {
+        command_show_usage("swapon", "[<disk> [start_lba] [pages]]");
+        terminal_writestring("Use part of an ATA disk (numbered as in lsdisks) as swap space.\n");
+        terminal_writestring("Everything on the disk in that range is overwritten.\n");
+        terminal_writestring("Without arguments, show swap usage and swap-in/out statistics.\n");
+        return 0;
+    }
+    
+    if (argc < 2) {
+        swap_print_stats();
+        return 0;
+    }
+    
+    ata_detect_disks();
+    int index = atoi(argv[1]);
+    if (index < 0 || index >= ata_disk_count) {
+        terminal_writestring("No such disk: ");
+        terminal_writestring(argv[1]);
+        terminal_writestring("\n");
+        return 1;
+    }
+    
+    uint32_t start_lba = argc >= 3 ? (uint32_t)atoi(argv[2]) : 0;
+    uint32_t pages = argc >= 4 ? (uint32_t)atoi(argv[3]) : 0;
+    if (!swap_on(&ata_disks[index], start_lba, pages)) {
+        return 1;
+    }
+    swap_print_stats();
+    return 0;
+}
+
+REGISTER_COMMAND("swapon", "Enable swap on an ATA disk", cmd_swapon_main)
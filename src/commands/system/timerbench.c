@@ -0,0 +1,119 @@
+#include "command.h"
+#include "terminal.h"
+#include "timer.h"
+#include "timer_wheel.h"
+#include "process.h"
+#include "memory.h"
+#include "string.h"
+#include "clock.h"
+
+#define TIMERBENCH_DEFAULT_COUNT 4096
+#define TIMERBENCH_MAX_COUNT     65536
+#define TIMERBENCH_MAX_DELAY     2000    // Ticks; spans the root and first outer level
+
+typedef struct {
+    uint32_t fired;
+    uint64_t max_late;               // Ticks past expiry, worst case
+} timerbench_state_t;
+
+static timerbench_state_t bench;
+
+static void timerbench_fire(void* data) {
+    ktimer_t* timer = (ktimer_t*)data;
+    uint64_t late = timer_ticks() - timer->expires;
+    if (late > bench.max_late) {
+        bench.max_late = late;
+    }
+    bench.fired++;
+}
+
+static void timerbench_report(const char* label, uint64_t cycles, uint32_t count) {
+    char buffer[32];
+    terminal_writestring(label);
+    uint32_to_string(count ? (uint32_t)(cycles / count) : 0, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" cycles/timer (");
+    uint32_to_string(count ? (uint32_t)clock_cycles_to_ns(cycles / count) : 0, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" ns)\n");
+}
+
+static int cmd_timerbench_main(int argc, char** argv) {
+    if (command_check_help_flag(argc, argv)) {
+        command_show_usage("timerbench", "[timers]");
+        terminal_writestring("Arm thousands of kernel timers with random delays, then cancel,\n");
+        terminal_writestring("re-arm and let them expire, measuring each operation.\n");
+        return 0;
+    }
+    
+    uint32_t count = argc >= 2 ? (uint32_t)atoi(argv[1]) : TIMERBENCH_DEFAULT_COUNT;
+    if (count == 0 || count > TIMERBENCH_MAX_COUNT) {
+        terminal_writestring("Timer count must be between 1 and 65536\n");
+        return 1;
+    }
+    
+    ktimer_t* timers = (ktimer_t*)kmalloc(count * sizeof(ktimer_t));
+    if (!timers) {
+        terminal_writestring("Error: Failed to allocate timers\n");
+        return 1;
+    }
+    bench.fired = 0;
+    bench.max_late = 0;
+    
+    // Random delays so timers land across slots and levels
+    uint32_t seed = 12345;
+    uint64_t start = clock_cycles();
+    for (uint32_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        timer_setup(&timers[i], timerbench_fire, &timers[i]);
+        timer_add(&timers[i], 1 + (seed >> 16) % TIMERBENCH_MAX_DELAY);
+    }
+    timerbench_report("  Add: ", clock_cycles() - start, count);
+    
+    // Cancel every other timer, then move the survivors
+    uint32_t cancelled = 0;
+    start = clock_cycles();
+    for (uint32_t i = 0; i < count; i += 2) {
+        cancelled += timer_cancel(&timers[i]);
+    }
+    timerbench_report("  Cancel: ", clock_cycles() - start, (count + 1) / 2);
+    
+    // A timer that already expired while the others were being added is
+    // armed again by timer_mod, and fires a second time
+    uint32_t refired = 0;
+    start = clock_cycles();
+    for (uint32_t i = 1; i < count; i += 2) {
+        seed = seed * 1103515245 + 12345;
+        refired += !timer_mod(&timers[i], 1 + (seed >> 16) % TIMERBENCH_MAX_DELAY);
+    }
+    timerbench_report("  Modify: ", clock_cycles() - start, count / 2);
+    
+    // Wait for the rest to expire
+    uint32_t expected = count - cancelled + refired;
+    uint64_t deadline = timer_ms() + TIMERBENCH_MAX_DELAY + 100;
+    while (bench.fired < expected && timer_ms() < deadline) {
+        process_sleep(10);
+    }
+    
+    char buffer[32];
+    terminal_writestring("  Fired: ");
+    uint32_to_string(bench.fired, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" of ");
+    uint32_to_string(expected, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(", at most ");
+    uint32_to_string((uint32_t)bench.max_late, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" ticks late\n  ");
+    timer_wheel_print_stats();
+    
+    // Anything still pending must not fire into freed memory
+    for (uint32_t i = 0; i < count; i++) {
+        timer_cancel(&timers[i]);
+    }
+    kfree(timers);
+    return bench.fired == expected ? 0 : 1;
+}
+
+REGISTER_COMMAND("timerbench", "Benchmark kernel timers", cmd_timerbench_main)
@@ -8,9 +8,31 @@
 #define ATA_SECONDARY_IO    0x170
 #define ATA_SECONDARY_CTRL  0x376
 
-// Identify command
+// Task file registers, as offsets from the I/O base
+#define ATA_REG_DATA        0
+#define ATA_REG_SECCOUNT    2
+#define ATA_REG_LBA_LOW     3
+#define ATA_REG_LBA_MID     4
+#define ATA_REG_LBA_HIGH    5
+#define ATA_REG_DRIVE       6
+#define ATA_REG_STATUS      7
+#define ATA_REG_COMMAND     7
+
+// Status bits
+#define ATA_STATUS_ERR      0x01
+#define ATA_STATUS_DRQ      0x08
+#define ATA_STATUS_DF       0x20
+#define ATA_STATUS_BSY      0x80
+
+// Commands
+#define ATA_CMD_READ_PIO    0x20
+#define ATA_CMD_WRITE_PIO   0x30
+#define ATA_CMD_FLUSH       0xE7
 #define ATA_CMD_IDENTIFY    0xEC
 
+// Status polls before a command is given up on
+#define ATA_TIMEOUT         1000000
+
 // Disk info struct
 ata_disk_t ata_disks[4];
 int ata_disk_count = 0;
@@ -40,6 +62,7 @@ static int ata_identify_drive(uint16_t io, uint16_t ctrl, int is_slave) {
         disk->model[2*i+1] = (char)(id[27 + i] & 0xFF);
     }
     disk->model[40] = 0;
+    disk->sectors = (uint32_t)id[60] | ((uint32_t)id[61] << 16);
     disk->present = 1;
     return 1;
 }
@@ -54,3 +77,96 @@ void ata_detect_disks() {
         }
     }
 }
+
+// The 400ns settle time after selecting a drive: four alternate status reads
+static void ata_delay(ata_disk_t* disk) {
+    for (int i = 0; i < 4; i++) {
+        inb(disk->ctrl_base);
+    }
+}
+
+// Wait for BSY to clear and, if want_data, for DRQ to set
+static int ata_wait(ata_disk_t* disk, int want_data) {
+    for (int i = 0; i < ATA_TIMEOUT; i++) {
+        uint8_t status = inb(disk->io_base + ATA_REG_STATUS);
+        if (status & ATA_STATUS_BSY) {
+            continue;
+        }
+        if (status & (ATA_STATUS_ERR | ATA_STATUS_DF)) {
+            return 0;
+        }
+        if (!want_data || (status & ATA_STATUS_DRQ)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Select the drive and load a 28-bit LBA transfer into the task file
+static int ata_setup(ata_disk_t* disk, uint32_t lba, uint8_t count, uint8_t command) {
+    if (!disk || !disk->present || count == 0 ||
+        lba >= disk->sectors || count > disk->sectors - lba) {
+        return 0;
+    }
+
+    uint16_t io = disk->io_base;
+    outb(io + ATA_REG_DRIVE, (disk->is_slave ? 0xF0 : 0xE0) | ((lba >> 24) & 0x0F));
+    ata_delay(disk);
+    if (!ata_wait(disk, 0)) {
+        return 0;
+    }
+    outb(io + ATA_REG_SECCOUNT, count);
+    outb(io + ATA_REG_LBA_LOW, (uint8_t)lba);
+    outb(io + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
+    outb(io + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 16));
+    outb(io + ATA_REG_COMMAND, command);
+    return 1;
+}
+
+int ata_read_sectors(ata_disk_t* disk, uint32_t lba, uint8_t count, void* buffer) {
+    if (!ata_setup(disk, lba, count, ATA_CMD_READ_PIO)) {
+        return 0;
+    }
+
+    uint16_t* data = (uint16_t*)buffer;
+    for (int sector = 0; sector < count; sector++) {
+        ata_delay(disk);
+        if (!ata_wait(disk, 1)) {
+            return 0;
+        }
+        for (int i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+            *data++ = inw(disk->io_base + ATA_REG_DATA);
+        }
+    }
+    return 1;
+}
+
+int ata_write_sectors(ata_disk_t* disk, uint32_t lba, uint8_t count, const void* buffer) {
+    if (!ata_setup(disk, lba, count, ATA_CMD_WRITE_PIO)) {
+        return 0;
+    }
+
+    const uint16_t* data = (const uint16_t*)buffer;
+    for (int sector = 0; sector < count; sector++) {
+        ata_delay(disk);
+        if (!ata_wait(disk, 1)) {
+            return 0;
+        }
+        for (int i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+            outw(disk->io_base + ATA_REG_DATA, *data++);
+        }
+    }
+    return ata_wait(disk, 0);
+}
+
+// Commit the drive's write cache to the medium
+int ata_flush(ata_disk_t* disk) {
+    if (!disk || !disk->present) {
+        return 0;
+    }
+    outb(disk->io_base + ATA_REG_DRIVE, disk->is_slave ? 0xF0 : 0xE0);
+    ata_delay(disk);
+    outb(disk->io_base + ATA_REG_COMMAND, ATA_CMD_FLUSH);
+    ata_delay(disk);
+    return ata_wait(disk, 0);
+}
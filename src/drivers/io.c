@@ -14,4 +14,7 @@ unsigned short inw(unsigned short port) {
     unsigned short ret;
     asm volatile ("inw %1, %0" : "=a"(ret) : "dN"(port));
     return ret;
-}
\ No newline at end of file
+}
+void outw(unsigned short port, unsigned short data) {
+    asm volatile ("outw %0, %1" : : "a"(data), "dN"(port));
+}
@@ -2,10 +2,23 @@
 #include "io.h"
 #include "process.h"
 #include "mouse.h"
+#include "idt.h"
+#include "pic.h"
 
 // A very simple keyboard driver
 
 #define KBD_DATA_PORT 0x60
+#define KBD_STATUS_PORT 0x64
+#define KBD_STATUS_AUX 0x20
+
+// Scancodes queued by the IRQ 1 handler. The handler only advances
+// kbd_head and readers only advance kbd_tail, so neither needs a lock.
+static uint8_t kbd_buffer[KEYBOARD_BUFFER_SIZE];
+static volatile uint32_t kbd_head = 0;
+static volatile uint32_t kbd_tail = 0;
+
+// Process blocked in keyboard_getchar, woken by the next scancode
+static process_t* volatile kbd_waiter = NULL;
 
 // Track shift key state
 static int shift_pressed = 0;
@@ -82,16 +95,80 @@ static const char kbd_us_shift[128] = {
     0,  /* All other keys are undefined */
 };
 
+static void keyboard_irq(interrupt_frame_t* frame) {
+    (void)frame;
+    
+    uint8_t status = inb(KBD_STATUS_PORT);
+    if (!(status & 1)) {
+        return;
+    }
+    uint8_t data = inb(KBD_DATA_PORT);
+    if (status & KBD_STATUS_AUX) {
+        mouse_handle_byte(data);
+        return;
+    }
+    
+    if (kbd_head - kbd_tail >= KEYBOARD_BUFFER_SIZE) {
+        return; // Nobody is reading; drop the newest key
+    }
+    kbd_buffer[kbd_head % KEYBOARD_BUFFER_SIZE] = data;
+    __asm__ volatile("" : : : "memory");
+    kbd_head++;
+    
+    process_t* waiter = kbd_waiter;
+    if (waiter) {
+        kbd_waiter = NULL;
+        if (waiter->state == PROCESS_STATE_BLOCKED) {
+            waiter->state = PROCESS_STATE_READY;
+        }
+    }
+}
+
+// Forget a terminated process that was waiting for a key
+void keyboard_release_process(process_t* proc) {
+    if (kbd_waiter == proc) {
+        kbd_waiter = NULL;
+    }
+}
+
 void keyboard_init() {
-    // Nothing to do for now
+    kbd_head = 0;
+    kbd_tail = 0;
+    idt_register_handler(PIC_IRQ_BASE + IRQ_KEYBOARD, keyboard_irq);
+    pic_unmask(IRQ_KEYBOARD);
 }
 
 int keyboard_has_input() {
-    return (inb(0x64) & 1);
+    return kbd_head != kbd_tail;
 }
 
+// Next queued scancode, or 0 if there is none
 unsigned char keyboard_read_scancode() {
-    return inb(KBD_DATA_PORT);
+    if (kbd_head == kbd_tail) {
+        return 0;
+    }
+    uint8_t scancode = kbd_buffer[kbd_tail % KEYBOARD_BUFFER_SIZE];
+    __asm__ volatile("" : : : "memory");
+    kbd_tail++;
+    return scancode;
+}
+
+// Sleep until the IRQ handler queues a scancode. Interrupts stay off
+// between the check and blocking so the wakeup cannot slip in between;
+// the switch saves them off and they come back on when this process runs.
+static void keyboard_wait(void) {
+    __asm__ volatile("cli");
+    if (kbd_head == kbd_tail) {
+        process_t* proc = process_get_current();
+        if (proc) {
+            kbd_waiter = proc;
+            proc->state = PROCESS_STATE_BLOCKED;
+            process_yield();
+        } else {
+            __asm__ volatile("sti; hlt");
+        }
+    }
+    __asm__ volatile("sti");
 }
 
 char keyboard_getchar() {
@@ -99,13 +176,6 @@ char keyboard_getchar() {
     while (1) {
         // Wait for a key press
         if (keyboard_has_input()) {
-            
-            // Check if it's mouse data
-            if (inb(0x64) & 0x20) {
-                 mouse_handle_byte(inb(KBD_DATA_PORT));
-                 continue;
-            }
-
             scancode = keyboard_read_scancode();
             
             // Handle shift key presses and releases
@@ -125,8 +195,7 @@ char keyboard_getchar() {
                 }
             }
         } else {
-            // Yield to other processes while waiting
-            process_yield();
+            keyboard_wait();
         }
     }
 }
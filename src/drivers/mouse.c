@@ -2,6 +2,9 @@
 #include "io.h"
 #include "vga.h"
 #include "memory.h"
+#include "idt.h"
+#include "pic.h"
+#include "timer.h"
 
 // Mouse state
 static int mouse_x = 160;
@@ -10,11 +13,19 @@ static int mouse_buttons = 0;
 static uint8_t mouse_cycle = 0;
 static int8_t mouse_byte[3];
 
+// Packets decoded by the IRQ handler, applied by mouse_update. The handler
+// only advances packet_head and mouse_update only advances packet_tail.
+static mouse_packet_t packet_queue[MOUSE_QUEUE_SIZE];
+static volatile uint32_t packet_head = 0;
+static volatile uint32_t packet_tail = 0;
+
 // Cursor state
-static uint8_t cursor_bg[100]; // 10x10 max
+#define CURSOR_SIZE 10
+static uint8_t cursor_bg[CURSOR_SIZE * CURSOR_SIZE];
 static int old_mouse_x = 160;
 static int old_mouse_y = 100;
 static int cursor_visible = 0;
+static uint64_t last_refresh_ms = 0;
 
 // Ports
 #define MOUSE_DATA_PORT 0x60
@@ -29,7 +40,7 @@ static int cursor_visible = 0;
 
 // Simple pointer cursor (10x10)
 // 0 = transparent, 1 = border (white), 2 = fill (black)
-static const uint8_t cursor_shape[10][10] = {
+static const uint8_t cursor_shape[CURSOR_SIZE][CURSOR_SIZE] = {
     {1, 1, 1, 1, 1, 0, 0, 0, 0, 0},
     {1, 1, 2, 1, 0, 0, 0, 0, 0, 0},
     {1, 2, 2, 2, 1, 0, 0, 0, 0, 0},
@@ -42,6 +53,13 @@ static const uint8_t cursor_shape[10][10] = {
     {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
 };
 
+static void mouse_irq(interrupt_frame_t* frame) {
+    (void)frame;
+    if (inb(MOUSE_STATUS_PORT) & 1) {
+        mouse_handle_byte(inb(MOUSE_DATA_PORT));
+    }
+}
+
 static void mouse_wait(uint8_t type) {
     int timeout = 100000;
     if (type == 0) { // Data
@@ -78,7 +96,7 @@ void mouse_init() {
     mouse_wait(1);
     outb(MOUSE_CMD_PORT, 0x20); // Get Compaq Status
     mouse_wait(0);
-    status = inb(MOUSE_DATA_PORT) | 2;
+    status = inb(MOUSE_DATA_PORT) | 3; // IRQ 1 and IRQ 12 on
     mouse_wait(1);
     outb(MOUSE_CMD_PORT, 0x60); // Set Compaq Status
     mouse_wait(1);
@@ -93,37 +111,46 @@ void mouse_init() {
     mouse_read(); // ACK
     
     mouse_cycle = 0;
+    idt_register_handler(PIC_IRQ_BASE + IRQ_MOUSE, mouse_irq);
+    pic_unmask(IRQ_MOUSE);
 }
 
-// Helpers for cursor drawing
+// Helpers for cursor drawing. The position is clamped so the cursor is
+// always fully on screen, and rows are addressed directly rather than
+// through the bounds-checked pixel calls.
 static void save_cursor_bg(int x, int y) {
-    for (int j = 0; j < 10; j++) {
-        for (int i = 0; i < 10; i++) {
-            cursor_bg[j * 10 + i] = vga_get_pixel(x + i, y + j);
+    for (int j = 0; j < CURSOR_SIZE; j++) {
+        const uint8_t* row = vga_state.framebuffer + (y + j) * VGA_GFX_WIDTH + x;
+        for (int i = 0; i < CURSOR_SIZE; i++) {
+            cursor_bg[j * CURSOR_SIZE + i] = row[i];
         }
     }
 }
 
 static void restore_cursor_bg(int x, int y) {
-    for (int j = 0; j < 10; j++) {
-        for (int i = 0; i < 10; i++) {
-            vga_put_pixel(x + i, y + j, cursor_bg[j * 10 + i]);
+    for (int j = 0; j < CURSOR_SIZE; j++) {
+        uint8_t* row = vga_state.framebuffer + (y + j) * VGA_GFX_WIDTH + x;
+        for (int i = 0; i < CURSOR_SIZE; i++) {
+            row[i] = cursor_bg[j * CURSOR_SIZE + i];
         }
     }
 }
 
 static void draw_cursor(int x, int y) {
-    for (int j = 0; j < 10; j++) {
-        for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < CURSOR_SIZE; j++) {
+        uint8_t* row = vga_state.framebuffer + (y + j) * VGA_GFX_WIDTH + x;
+        for (int i = 0; i < CURSOR_SIZE; i++) {
             if (cursor_shape[j][i] == 1) {
-                vga_put_pixel(x + i, y + j, 15); // White
+                row[i] = 15; // White
             } else if (cursor_shape[j][i] == 2) {
-                vga_put_pixel(x + i, y + j, 0);  // Black
+                row[i] = 0;  // Black
             }
         }
     }
 }
 
+// Assemble packets from the byte stream and queue them. Runs in interrupt
+// context, so it leaves the screen alone.
 void mouse_handle_byte(uint8_t data) {
     switch(mouse_cycle) {
         case 0:
@@ -140,12 +167,11 @@ void mouse_handle_byte(uint8_t data) {
             mouse_byte[2] = data;
             mouse_cycle = 0;
             
-            // Should be in graphics mode to draw
-            if (!vga_state.graphics_mode) {
-                cursor_visible = 0;
+            // Nobody is applying packets; drop the newest
+            if (packet_head - packet_tail >= MOUSE_QUEUE_SIZE) {
                 return;
             }
-
+            
             // Process packet
             uint8_t raw_dx = mouse_byte[1];
             uint8_t raw_dy = mouse_byte[2];
@@ -157,33 +183,84 @@ void mouse_handle_byte(uint8_t data) {
             if (mouse_byte[0] & 0x10) dx |= 0xFF00; // X sign bit
             if (mouse_byte[0] & 0x20) dy |= 0xFF00; // Y sign bit
             
-            // Restore old cursor if visible
-            if (cursor_visible) {
-                restore_cursor_bg(old_mouse_x, old_mouse_y);
-            }
-            
-            mouse_x += dx;
-            mouse_y -= dy; // Invert Y
-            
-            // Clamp
-            if (mouse_x < 0) mouse_x = 0;
-            if (mouse_y < 0) mouse_y = 0;
-            if (mouse_x >= VGA_GFX_WIDTH - 10) mouse_x = VGA_GFX_WIDTH - 10;
-            if (mouse_y >= VGA_GFX_HEIGHT - 10) mouse_y = VGA_GFX_HEIGHT - 10;
-            
-            mouse_buttons = mouse_byte[0] & 0x07;
-            
-            // Draw new cursor
-            save_cursor_bg(mouse_x, mouse_y);
-            draw_cursor(mouse_x, mouse_y);
-            
-            old_mouse_x = mouse_x;
-            old_mouse_y = mouse_y;
-            cursor_visible = 1;
+            mouse_packet_t* packet = &packet_queue[packet_head % MOUSE_QUEUE_SIZE];
+            packet->dx = dx;
+            packet->dy = -dy; // Invert Y
+            packet->buttons = mouse_byte[0] & 0x07;
+            __asm__ volatile("" : : : "memory");
+            packet_head++;
             break;
     }
 }
 
+int mouse_has_motion() {
+    return packet_head != packet_tail;
+}
+
+// Apply every queued packet as one movement and redraw the cursor once.
+// Pass screen_redrawn after replacing the whole frame: the cursor and the
+// background saved under it are gone, so it is drawn fresh.
+void mouse_update(int screen_redrawn) {
+    int dx = 0;
+    int dy = 0;
+    int moved = 0;
+    while (packet_tail != packet_head) {
+        mouse_packet_t* packet = &packet_queue[packet_tail % MOUSE_QUEUE_SIZE];
+        dx += packet->dx;
+        dy += packet->dy;
+        mouse_buttons = packet->buttons;
+        __asm__ volatile("" : : : "memory");
+        packet_tail++;
+        moved = 1;
+    }
+    
+    if (screen_redrawn || !vga_state.graphics_mode) {
+        cursor_visible = 0;
+    }
+    
+    mouse_x += dx;
+    mouse_y += dy;
+    
+    // Clamp
+    if (mouse_x < 0) mouse_x = 0;
+    if (mouse_y < 0) mouse_y = 0;
+    if (mouse_x >= VGA_GFX_WIDTH - CURSOR_SIZE) mouse_x = VGA_GFX_WIDTH - CURSOR_SIZE;
+    if (mouse_y >= VGA_GFX_HEIGHT - CURSOR_SIZE) mouse_y = VGA_GFX_HEIGHT - CURSOR_SIZE;
+    
+    // Should be in graphics mode to draw
+    if (!vga_state.graphics_mode || (cursor_visible && !moved)) {
+        return;
+    }
+    
+    // Restore old cursor if visible
+    if (cursor_visible) {
+        restore_cursor_bg(old_mouse_x, old_mouse_y);
+    }
+    
+    // Draw new cursor
+    save_cursor_bg(mouse_x, mouse_y);
+    draw_cursor(mouse_x, mouse_y);
+    
+    old_mouse_x = mouse_x;
+    old_mouse_y = mouse_y;
+    cursor_visible = 1;
+}
+
+// For callers without a frame loop of their own. Pending motion is applied
+// at most once per display frame; until then it stays queued for a later
+// call, so the caller never waits here.
+void mouse_refresh() {
+    if (!mouse_has_motion()) {
+        return;
+    }
+    uint64_t now = timer_ms();
+    if (vga_state.graphics_mode && now - last_refresh_ms < MOUSE_REFRESH_MS) {
+        return;
+    }
+    last_refresh_ms = now;
+    mouse_update(0);
+}
+
 int mouse_get_x() { return mouse_x; }
 int mouse_get_y() { return mouse_y; }
 int mouse_get_buttons() { return mouse_buttons; }
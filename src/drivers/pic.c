@@ -0,0 +1,81 @@
+#include "pic.h"
+#include "io.h"
+
+// Master and slave command/data ports
+#define PIC1_COMMAND  0x20
+#define PIC1_DATA     0x21
+#define PIC2_COMMAND  0xA0
+#define PIC2_DATA     0xA1
+
+#define PIC_ICW1_INIT 0x11               // Edge triggered, cascade, ICW4 follows
+#define PIC_ICW4_8086 0x01
+#define PIC_READ_ISR  0x0B
+#define PIC_EOI       0x20
+
+// Give the PIC time to settle between initialization words
+static void pic_io_wait(void) {
+    outb(0x80, 0);
+}
+
+void pic_init(void) {
+    outb(PIC1_COMMAND, PIC_ICW1_INIT);
+    pic_io_wait();
+    outb(PIC2_COMMAND, PIC_ICW1_INIT);
+    pic_io_wait();
+    outb(PIC1_DATA, PIC_IRQ_BASE);       // ICW2: vector offsets
+    pic_io_wait();
+    outb(PIC2_DATA, PIC_IRQ_BASE + 8);
+    pic_io_wait();
+    outb(PIC1_DATA, 1 << IRQ_CASCADE);   // ICW3: slave on IRQ2
+    pic_io_wait();
+    outb(PIC2_DATA, IRQ_CASCADE);
+    pic_io_wait();
+    outb(PIC1_DATA, PIC_ICW4_8086);
+    pic_io_wait();
+    outb(PIC2_DATA, PIC_ICW4_8086);
+    pic_io_wait();
+
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+}
+
+void pic_unmask(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) & ~(1 << (irq - 8)));
+        irq = IRQ_CASCADE;
+    }
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << irq));
+}
+
+void pic_mask(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) | (1 << (irq - 8)));
+    } else {
+        outb(PIC1_DATA, inb(PIC1_DATA) | (1 << irq));
+    }
+}
+
+void pic_send_eoi(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_COMMAND, PIC_EOI);
+    }
+    outb(PIC1_COMMAND, PIC_EOI);
+}
+
+// IRQ 7 and 15 also fire when a request goes away before it is serviced.
+// Those are not in service and must not be acknowledged, except that the
+// master did see a real IRQ 2 for a spurious slave interrupt.
+int pic_is_spurious(uint8_t irq) {
+    if (irq == 7) {
+        outb(PIC1_COMMAND, PIC_READ_ISR);
+        return !(inb(PIC1_COMMAND) & 0x80);
+    }
+    if (irq == 15) {
+        outb(PIC2_COMMAND, PIC_READ_ISR);
+        if (!(inb(PIC2_COMMAND) & 0x80)) {
+            outb(PIC1_COMMAND, PIC_EOI);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,18 +1,35 @@
 #include "timer.h"
 #include "io.h"
+#include "idt.h"
+#include "pic.h"
+#include "process.h"
+#include "timer_wheel.h"
 
+// Written only by the tick handler; 64-bit loads are atomic
+static volatile uint64_t tick_count = 0;
+
+static void timer_irq(interrupt_frame_t* frame) {
+    (void)frame;
+    tick_count++;
+    process_wake_sleepers(tick_count);
+    timer_wheel_run(tick_count);
+}
+
+// Start the periodic system tick on IRQ 0
 void timer_init() {
     // Channel 0, Access lo/hi, Mode 2 (Rate Generator), Binary
     outb(PIT_CMD_PORT, 0x34);
-    // Set count to 0 (65536)
-    outb(PIT_CH0_PORT, 0x00);
-    outb(PIT_CH0_PORT, 0x00);
+    outb(PIT_CH0_PORT, TIMER_DIVISOR & 0xFF);
+    outb(PIT_CH0_PORT, TIMER_DIVISOR >> 8);
+    
+    idt_register_handler(PIC_IRQ_BASE + IRQ_TIMER, timer_irq);
+    pic_unmask(IRQ_TIMER);
+}
+
+uint64_t timer_ticks() {
+    return tick_count;
 }
 
-uint16_t timer_read_count() {
-    uint16_t count = 0;
-    outb(PIT_CMD_PORT, 0x00); // Latch
-    count = inb(PIT_CH0_PORT);
-    count |= (inb(PIT_CH0_PORT) << 8);
-    return count;
+uint64_t timer_ms() {
+    return tick_count * 1000 / TIMER_HZ;
 }
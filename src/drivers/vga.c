@@ -2,6 +2,7 @@
 #include "io.h"
 #include "string.h"
 #include "memory.h"
+#include "vmm.h"
 
 // VGA state
 vga_state_t vga_state = {0};
@@ -178,6 +179,10 @@ static const uint8_t mode13h_regs[] = {
 
 // Initialize VGA graphics
 int vga_init(void) {
+    // Frame flips are large sequential writes: let them combine into
+    // bursts instead of going out one store at a time
+    vmm_protect(VGA_MEMORY, VGA_MEMORY_SIZE, VMM_MAP_WRITE | VMM_MAP_WRITECOMBINE);
+    
     vga_state.graphics_mode = 0;
     vga_state.width = 80;  // Text mode initially
     vga_state.height = 25;
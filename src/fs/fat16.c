@@ -1,12 +1,16 @@
 #include "fat16.h"
 #include "ramdisk.h"
 #include "memory.h"
+#include "slab.h"
 #include "terminal.h"
 #include "string.h"
 #include "memory_utils.h"
+#include "frame.h"
+#include "process.h"
+#include "idt.h"
 
 // Current directory tracking
-static char current_directory[256] = "/";
+static char current_directory[FAT16_MAX_PATH] = "/";
 static uint16_t current_directory_cluster = 0;  // 0 means root directory
 
 // FAT16 layout in our ramdisk:
@@ -25,6 +29,24 @@ static uint16_t current_directory_cluster = 0;  // 0 means root directory
 #define FAT16_SECTORS_PER_FAT 16
 #define FAT16_ROOT_SECTORS    32
 
+// Slab caches for sector/cluster buffers and path strings, keeping the
+// larger I/O buffers off the (small) process stacks
+static kmem_cache_t* sector_cache = NULL;
+static kmem_cache_t* cluster_cache = NULL;
+static kmem_cache_t* path_cache = NULL;
+
+static void fat16_init_caches(void) {
+    if (!sector_cache) {
+        sector_cache = kmem_cache_create("fat16_sector", FAT16_SECTOR_SIZE, 0, NULL);
+    }
+    if (!cluster_cache) {
+        cluster_cache = kmem_cache_create("fat16_cluster", FAT16_CLUSTER_SIZE, 0, NULL);
+    }
+    if (!path_cache) {
+        path_cache = kmem_cache_create("fat16_path", FAT16_MAX_PATH, 0, NULL);
+    }
+}
+
 // Helper function to convert string to uppercase FAT16 format
 static void fat16_name_to_fatname(const char* name, char* fatname) {
     int i, j;
@@ -115,7 +137,11 @@ int fat16_format(void) {
     }
     
     // Initialize FAT tables
-    uint8_t fat_sector[FAT16_SECTOR_SIZE];
+    fat16_init_caches();
+    uint8_t* fat_sector = (uint8_t*)kmem_cache_alloc(sector_cache);
+    if (!fat_sector) {
+        return 0;
+    }
     memset(fat_sector, 0, FAT16_SECTOR_SIZE);
     
     // First FAT sector has special entries
@@ -134,13 +160,12 @@ int fat16_format(void) {
         ramdisk_write_sector(FAT16_FAT2_START + i, fat_sector);
     }
     
-    // Clear root directory
-    uint8_t root_sector[FAT16_SECTOR_SIZE];
-    memset(root_sector, 0, FAT16_SECTOR_SIZE);
+    // Clear root directory (the zeroed FAT sector doubles as the source)
     for (int i = 0; i < FAT16_ROOT_SECTORS; i++) {
-        ramdisk_write_sector(FAT16_ROOT_START + i, root_sector);
+        ramdisk_write_sector(FAT16_ROOT_START + i, fat_sector);
     }
     
+    kmem_cache_free(sector_cache, fat_sector);
     return 1;
 }
 
@@ -199,8 +224,16 @@ int fat16_write_cluster(uint16_t cluster, const void* buffer) {
 }
 
 int fat16_create_file(const char* filename, const void* data, size_t size) {
+    fat16_init_caches();
+    uint8_t* dir_sector = (uint8_t*)kmem_cache_alloc(sector_cache);
+    uint8_t* cluster_data = (uint8_t*)kmem_cache_alloc(cluster_cache);
+    int result = 0;
+    
+    if (!dir_sector || !cluster_data) {
+        goto out;
+    }
+    
     // Find free directory entry in current directory
-    uint8_t dir_sector[FAT16_SECTOR_SIZE];
     fat16_dir_entry_t* entry = NULL;
     uint32_t entry_sector = 0;
     uint32_t start_sector = (current_directory_cluster == 0) ? FAT16_ROOT_START : 
@@ -210,7 +243,7 @@ int fat16_create_file(const char* filename, const void* data, size_t size) {
     for (uint32_t sector = 0; sector < sectors_to_read; sector++) {
         uint32_t actual_sector = start_sector + sector;
         if (!ramdisk_read_sector(actual_sector, dir_sector)) {
-            return 0;
+            goto out;
         }
         
         for (uint32_t i = 0; i < FAT16_SECTOR_SIZE / sizeof(fat16_dir_entry_t); i++) {
@@ -229,7 +262,7 @@ int fat16_create_file(const char* filename, const void* data, size_t size) {
     }
     
     if (!entry) {
-        return 0; // No free directory entry
+        goto out; // No free directory entry
     }
     
     // Convert filename to FAT16 format
@@ -247,7 +280,7 @@ int fat16_create_file(const char* filename, const void* data, size_t size) {
         uint16_t clusters_needed = (size + FAT16_CLUSTER_SIZE - 1) / FAT16_CLUSTER_SIZE;
         uint16_t first_cluster = fat16_find_free_cluster();
         if (first_cluster == 0) {
-            return 0;
+            goto out;
         }
         
         entry->cluster_low = first_cluster;
@@ -255,7 +288,6 @@ int fat16_create_file(const char* filename, const void* data, size_t size) {
         // Write file data to contiguous clusters
         const uint8_t* file_data = (const uint8_t*)data;
         for (uint16_t i = 0; i < clusters_needed; i++) {
-            uint8_t cluster_data[FAT16_CLUSTER_SIZE];
             memset(cluster_data, 0, FAT16_CLUSTER_SIZE);
             
             size_t offset = i * FAT16_CLUSTER_SIZE;
@@ -263,71 +295,92 @@ int fat16_create_file(const char* filename, const void* data, size_t size) {
             memcpy(cluster_data, file_data + offset, to_copy);
             
             if (!fat16_write_cluster(first_cluster + i, cluster_data)) {
-                return 0;
+                goto out;
             }
         }
     }
     
     // Write directory entry back to disk
-    if (!ramdisk_write_sector(entry_sector, dir_sector)) {
-        return 0;
-    }
+    result = ramdisk_write_sector(entry_sector, dir_sector);
     
-    return 1;
+out:
+    if (dir_sector) {
+        kmem_cache_free(sector_cache, dir_sector);
+    }
+    if (cluster_data) {
+        kmem_cache_free(cluster_cache, cluster_data);
+    }
+    return result;
 }
 
 int fat16_list_files(void) {
     return fat16_list_directory(".");
 }
 
-int fat16_read_file(const char* filename, void* buffer, size_t max_size) {
+// Look a name up in the current directory and copy its entry out
+int fat16_find_entry(const char* filename, fat16_dir_entry_t* result) {
     // Convert filename to FAT16 format
     char fatname[11];
     fat16_name_to_fatname(filename, fatname);
     
-    // Find file in current directory
-    uint8_t dir_sector[FAT16_SECTOR_SIZE];
-    fat16_dir_entry_t* entry = NULL;
+    fat16_init_caches();
+    uint8_t* dir_sector = (uint8_t*)kmem_cache_alloc(sector_cache);
+    int found = 0;
+    
+    if (!dir_sector) {
+        return 0;
+    }
+    
     uint32_t start_sector = (current_directory_cluster == 0) ? FAT16_ROOT_START : 
                            FAT16_DATA_START + (current_directory_cluster - 2) * 2;
     uint32_t sectors_to_read = (current_directory_cluster == 0) ? FAT16_ROOT_SECTORS : 2;
     
-    for (uint32_t sector = 0; sector < sectors_to_read; sector++) {
+    for (uint32_t sector = 0; sector < sectors_to_read && !found; sector++) {
         if (!ramdisk_read_sector(start_sector + sector, dir_sector)) {
-            return 0;
+            break;
         }
         
         for (uint32_t i = 0; i < FAT16_SECTOR_SIZE / sizeof(fat16_dir_entry_t); i++) {
-            fat16_dir_entry_t* dir_entry = (fat16_dir_entry_t*)&dir_sector[i * sizeof(fat16_dir_entry_t)];
+            fat16_dir_entry_t* entry = (fat16_dir_entry_t*)&dir_sector[i * sizeof(fat16_dir_entry_t)];
             
-            if (dir_entry->name[0] == 0x00) {
-                break;
+            if (entry->name[0] == 0x00) {
+                break; // End of directory
             }
             
-            if (fat16_name_compare(dir_entry->name, fatname) == 0) {
-                entry = dir_entry;
+            if (fat16_name_compare(entry->name, fatname) == 0) {
+                memcpy(result, entry, sizeof(fat16_dir_entry_t));
+                found = 1;
                 break;
             }
         }
-        
-        if (entry) {
-            break;
-        }
     }
     
-    if (!entry) {
+    kmem_cache_free(sector_cache, dir_sector);
+    return found;
+}
+
+int fat16_read_file(const char* filename, void* buffer, size_t max_size) {
+    fat16_dir_entry_t entry;
+    if (!fat16_find_entry(filename, &entry)) {
         return 0; // File not found
     }
     
+    uint8_t* cluster_data = (uint8_t*)kmem_cache_alloc(cluster_cache);
+    int result = 0;
+    
+    if (!cluster_data) {
+        return 0;
+    }
+    
     // Simplified: read contiguous clusters
-    size_t bytes_to_read = (entry->file_size < max_size) ? entry->file_size : max_size;
+    size_t bytes_to_read = (entry.file_size < max_size) ? entry.file_size : max_size;
     uint16_t clusters_needed = (bytes_to_read + FAT16_CLUSTER_SIZE - 1) / FAT16_CLUSTER_SIZE;
     uint8_t* buf = (uint8_t*)buffer;
     
     for (uint16_t i = 0; i < clusters_needed; i++) {
-        uint8_t cluster_data[FAT16_CLUSTER_SIZE];
-        if (!fat16_read_cluster(entry->cluster_low + i, cluster_data)) {
-            return i * FAT16_CLUSTER_SIZE;
+        if (!fat16_read_cluster(entry.cluster_low + i, cluster_data)) {
+            result = i * FAT16_CLUSTER_SIZE;
+            goto out;
         }
         
         size_t offset = i * FAT16_CLUSTER_SIZE;
@@ -335,39 +388,19 @@ int fat16_read_file(const char* filename, void* buffer, size_t max_size) {
         memcpy(buf + offset, cluster_data, to_copy);
     }
     
-    return bytes_to_read;
+    result = bytes_to_read;
+    
+out:
+    kmem_cache_free(cluster_cache, cluster_data);
+    return result;
 }
 
 int fat16_get_file_size(const char* filename) {
-    // Convert filename to FAT16 format
-    char fatname[11];
-    fat16_name_to_fatname(filename, fatname);
-    
-    // Find file in current directory
-    uint8_t dir_sector[FAT16_SECTOR_SIZE];
-    uint32_t start_sector = (current_directory_cluster == 0) ? FAT16_ROOT_START : 
-                           FAT16_DATA_START + (current_directory_cluster - 2) * 2;
-    uint32_t sectors_to_read = (current_directory_cluster == 0) ? FAT16_ROOT_SECTORS : 2;
-    
-    for (uint32_t sector = 0; sector < sectors_to_read; sector++) {
-        if (!ramdisk_read_sector(start_sector + sector, dir_sector)) {
-            return -1;
-        }
-        
-        for (uint32_t i = 0; i < FAT16_SECTOR_SIZE / sizeof(fat16_dir_entry_t); i++) {
-            fat16_dir_entry_t* entry = (fat16_dir_entry_t*)&dir_sector[i * sizeof(fat16_dir_entry_t)];
-            
-            if (entry->name[0] == 0x00) {
-                break; // End of directory
-            }
-            
-            if (fat16_name_compare(entry->name, fatname) == 0) {
-                return entry->file_size;
-            }
-        }
+    fat16_dir_entry_t entry;
+    if (!fat16_find_entry(filename, &entry)) {
+        return -1; // File not found
     }
-    
-    return -1; // File not found
+    return entry.file_size;
 }
 
 // Directory support functions
@@ -377,14 +410,19 @@ char* fat16_get_current_directory(void) {
     return current_directory;
 }
 
-// Parse a path into components
+// Parse a path into components (release them with fat16_free_path)
 int fat16_parse_path(const char* path, char* components[], int max_components) {
-    if (!path || !components) {
+    if (!path || !components || strlen(path) >= FAT16_MAX_PATH) {
         return 0;
     }
     
+    fat16_init_caches();
+    
     int count = 0;
-    char* path_copy = (char*)kmalloc(strlen(path) + 1);
+    char* path_copy = (char*)kmem_cache_alloc(path_cache);
+    if (!path_copy) {
+        return 0;
+    }
     strcpy(path_copy, path);
     
     char* token = strtok(path_copy, "/");
@@ -393,11 +431,14 @@ int fat16_parse_path(const char* path, char* components[], int max_components) {
             if (strcmp(token, "..") == 0) {
                 // Parent directory - remove last component if possible
                 if (count > 0) {
-                    kfree(components[count - 1]);
+                    kmem_cache_free(path_cache, components[count - 1]);
                     count--;
                 }
             } else {
-                components[count] = (char*)kmalloc(strlen(token) + 1);
+                components[count] = (char*)kmem_cache_alloc(path_cache);
+                if (!components[count]) {
+                    break;
+                }
                 strcpy(components[count], token);
                 count++;
             }
@@ -405,18 +446,34 @@ int fat16_parse_path(const char* path, char* components[], int max_components) {
         token = strtok(NULL, "/");
     }
     
-    kfree(path_copy);
+    kmem_cache_free(path_cache, path_copy);
     return count;
 }
 
+// Release components returned by fat16_parse_path
+void fat16_free_path(char* components[], int count) {
+    for (int i = 0; i < count; i++) {
+        kmem_cache_free(path_cache, components[i]);
+        components[i] = NULL;
+    }
+}
+
 // Create a new directory
 int fat16_create_directory(const char* dirname) {
     if (!dirname || strlen(dirname) == 0) {
         return 0;
     }
     
+    fat16_init_caches();
+    uint8_t* dir_sector = (uint8_t*)kmem_cache_alloc(sector_cache);
+    uint8_t* new_dir_data = (uint8_t*)kmem_cache_alloc(cluster_cache);
+    int result = 0;
+    
+    if (!dir_sector || !new_dir_data) {
+        goto out;
+    }
+    
     // Find free directory entry in current directory
-    uint8_t dir_sector[FAT16_SECTOR_SIZE];
     fat16_dir_entry_t* entry = NULL;
     uint32_t entry_sector = 0;
     uint32_t start_sector = (current_directory_cluster == 0) ? FAT16_ROOT_START : 
@@ -426,7 +483,7 @@ int fat16_create_directory(const char* dirname) {
     for (uint32_t sector = 0; sector < sectors_to_read; sector++) {
         uint32_t actual_sector = start_sector + sector;
         if (!ramdisk_read_sector(actual_sector, dir_sector)) {
-            return 0;
+            goto out;
         }
         
         for (uint32_t i = 0; i < FAT16_SECTOR_SIZE / sizeof(fat16_dir_entry_t); i++) {
@@ -445,13 +502,13 @@ int fat16_create_directory(const char* dirname) {
     }
     
     if (!entry) {
-        return 0; // No free directory entry
+        goto out; // No free directory entry
     }
     
     // Allocate a cluster for the new directory
     uint16_t dir_cluster = fat16_find_free_cluster();
     if (dir_cluster == 0) {
-        return 0;
+        goto out;
     }
     
     // Create directory entry
@@ -466,11 +523,10 @@ int fat16_create_directory(const char* dirname) {
     
     // Write directory entry back to disk
     if (!ramdisk_write_sector(entry_sector, dir_sector)) {
-        return 0;
+        goto out;
     }
     
     // Initialize the new directory with . and .. entries
-    uint8_t new_dir_data[FAT16_CLUSTER_SIZE];
     memset(new_dir_data, 0, FAT16_CLUSTER_SIZE);
     
     // Create "." entry (current directory)
@@ -489,11 +545,16 @@ int fat16_create_directory(const char* dirname) {
     dotdot_entry->cluster_low = current_directory_cluster; // Parent cluster (0 for root)
     
     // Write the new directory data
-    if (!fat16_write_cluster(dir_cluster, new_dir_data)) {
-        return 0;
-    }
+    result = fat16_write_cluster(dir_cluster, new_dir_data);
     
-    return 1;
+out:
+    if (dir_sector) {
+        kmem_cache_free(sector_cache, dir_sector);
+    }
+    if (new_dir_data) {
+        kmem_cache_free(cluster_cache, new_dir_data);
+    }
+    return result;
 }
 
 // Change current directory
@@ -679,3 +740,209 @@ end_listing:
     
     return 1;
 }
+
+// Memory-mapped files. Pages are read in on first access. Pages of a
+// writable mapping start out read-only, so the first write to each one
+// faults and marks it dirty; writeback clears the mark and write-protects
+// the page again. Processes run in ring 0, so this relies on vmm_init
+// setting CR0.WP; without it those writes never fault and are lost.
+
+#define FAT16_CLUSTERS_PER_PAGE (VMM_PAGE_SIZE / FAT16_CLUSTER_SIZE)
+
+typedef struct {
+    process_t* proc;                 // NULL when the slot is free
+    uint16_t first_cluster;          // Files are stored in contiguous clusters
+    uint32_t file_size;
+    size_t size;                     // Mapped bytes, whole pages
+    int flags;
+    uint8_t dirty[FAT16_MMAP_SLOT_SIZE / VMM_PAGE_SIZE / 8];
+} fat16_mapping_t;
+
+static fat16_mapping_t fat16_mappings[FAT16_MMAP_MAX];
+
+static uint64_t fat16_mapping_base(fat16_mapping_t* mapping) {
+    return FAT16_MMAP_BASE + (uint64_t)(mapping - fat16_mappings) * FAT16_MMAP_SLOT_SIZE;
+}
+
+// Kernel-accessible address of a resident mapped page: the mapping itself
+// while its process runs, the identity map otherwise
+static uint8_t* fat16_mapping_page(fat16_mapping_t* mapping, uint64_t page) {
+    if (mapping->proc == current_process) {
+        return (uint8_t*)page;
+    }
+    uint64_t phys = vmm_space_translate(mapping->proc->address_space, page);
+    if (!phys || phys + VMM_PAGE_SIZE > vmm_identity_limit()) {
+        return NULL;
+    }
+    return (uint8_t*)(uintptr_t)phys;
+}
+
+static int fat16_mmap_fault(process_t* proc, vm_area_t* vma, uint64_t page, uint64_t error_code) {
+    fat16_mapping_t* mapping = (fat16_mapping_t*)vma->data;
+    size_t index = (page - vma->start) / VMM_PAGE_SIZE;
+    int write = (error_code & PAGE_FAULT_WRITE) != 0;
+    
+    if (write && !(mapping->flags & FAT16_MAP_WRITE)) {
+        return 0;
+    }
+    
+    if (error_code & PAGE_FAULT_PRESENT) {
+        // First write to a clean page
+        mapping->dirty[index / 8] |= 1 << (index % 8);
+        return vmm_space_protect(proc->address_space, page, VMM_PAGE_SIZE, vma->flags);
+    }
+    
+    uint64_t phys = frame_alloc();
+    if (!phys) {
+        return 0;
+    }
+    if (!vmm_space_map(proc->address_space, page, phys, VMM_PAGE_SIZE, VMM_MAP_WRITE | VMM_MAP_NOEXEC)) {
+        frame_free(phys);
+        return 0;
+    }
+    
+    // Faults in the user half come from the running process, so the page
+    // is reachable at its own address. Bytes past the end of file read as 0.
+    uint8_t* data = (uint8_t*)page;
+    size_t offset = index * VMM_PAGE_SIZE;
+    memset(data, 0, VMM_PAGE_SIZE);
+    for (size_t i = 0; i < FAT16_CLUSTERS_PER_PAGE && offset + i * FAT16_CLUSTER_SIZE < mapping->file_size; i++) {
+        uint16_t cluster = mapping->first_cluster + offset / FAT16_CLUSTER_SIZE + i;
+        if (!fat16_read_cluster(cluster, data + i * FAT16_CLUSTER_SIZE)) {
+            vmm_space_unmap(proc->address_space, page, VMM_PAGE_SIZE);
+            frame_free(phys);
+            return 0;
+        }
+    }
+    if (offset + VMM_PAGE_SIZE > mapping->file_size) {
+        memset(data + (mapping->file_size - offset), 0, offset + VMM_PAGE_SIZE - mapping->file_size);
+    }
+    proc->resident_pages++;
+    
+    if (write) {
+        mapping->dirty[index / 8] |= 1 << (index % 8);
+        return 1;
+    }
+    return vmm_space_protect(proc->address_space, page, VMM_PAGE_SIZE, VMM_MAP_NOEXEC);
+}
+
+// Write every dirty page back to its clusters and mark it clean
+static int fat16_mapping_writeback(fat16_mapping_t* mapping) {
+    uint64_t base = fat16_mapping_base(mapping);
+    int result = 1;
+    
+    for (size_t index = 0; index < mapping->size / VMM_PAGE_SIZE; index++) {
+        if (!(mapping->dirty[index / 8] & (1 << (index % 8)))) {
+            continue;
+        }
+        
+        uint64_t page = base + index * VMM_PAGE_SIZE;
+        uint8_t* data = fat16_mapping_page(mapping, page);
+        if (!data) {
+            result = 0;
+            continue;
+        }
+        
+        size_t offset = index * VMM_PAGE_SIZE;
+        for (size_t i = 0; i < FAT16_CLUSTERS_PER_PAGE && offset + i * FAT16_CLUSTER_SIZE < mapping->file_size; i++) {
+            uint16_t cluster = mapping->first_cluster + offset / FAT16_CLUSTER_SIZE + i;
+            if (!fat16_write_cluster(cluster, data + i * FAT16_CLUSTER_SIZE)) {
+                result = 0;
+            }
+        }
+        
+        mapping->dirty[index / 8] &= ~(1 << (index % 8));
+        vmm_space_protect(mapping->proc->address_space, page, VMM_PAGE_SIZE, VMM_MAP_NOEXEC);
+    }
+    
+    return result;
+}
+
+// Write back, free the pages and forget the mapping
+static int fat16_mapping_release(fat16_mapping_t* mapping) {
+    process_t* proc = mapping->proc;
+    uint64_t base = fat16_mapping_base(mapping);
+    int result = fat16_mapping_writeback(mapping);
+    
+    for (uint64_t page = base; page < base + mapping->size; page += VMM_PAGE_SIZE) {
+        uint64_t phys = vmm_space_translate(proc->address_space, page);
+        if (phys) {
+            frame_free(phys);
+            proc->resident_pages--;
+        }
+    }
+    vmm_space_unmap(proc->address_space, base, mapping->size);
+    process_unmap_area(proc, base);
+    
+    memset(mapping, 0, sizeof(fat16_mapping_t));
+    return result;
+}
+
+static fat16_mapping_t* fat16_find_mapping(void* addr) {
+    for (int i = 0; i < FAT16_MMAP_MAX; i++) {
+        if (fat16_mappings[i].proc && fat16_mappings[i].proc == current_process &&
+            fat16_mapping_base(&fat16_mappings[i]) == (uint64_t)addr) {
+            return &fat16_mappings[i];
+        }
+    }
+    return NULL;
+}
+
+void* fat16_mmap(const char* filename, int flags) {
+    process_t* proc = current_process;
+    fat16_dir_entry_t entry;
+    
+    if (!proc || !proc->address_space || !fat16_find_entry(filename, &entry) ||
+        (entry.attributes & FAT16_ATTR_DIRECTORY) || entry.file_size == 0 ||
+        entry.file_size > FAT16_MMAP_SLOT_SIZE) {
+        return NULL;
+    }
+    if ((flags & FAT16_MAP_WRITE) && (entry.attributes & FAT16_ATTR_READ_ONLY)) {
+        return NULL;
+    }
+    
+    fat16_mapping_t* mapping = NULL;
+    for (int i = 0; i < FAT16_MMAP_MAX; i++) {
+        if (!fat16_mappings[i].proc) {
+            mapping = &fat16_mappings[i];
+            break;
+        }
+    }
+    if (!mapping) {
+        return NULL;
+    }
+    
+    uint64_t base = fat16_mapping_base(mapping);
+    size_t size = (entry.file_size + VMM_PAGE_SIZE - 1) & ~(VMM_PAGE_SIZE - 1);
+    uint32_t vm_flags = VMM_MAP_NOEXEC | ((flags & FAT16_MAP_WRITE) ? VMM_MAP_WRITE : 0);
+    if (!process_map_area(proc, base, base + size, vm_flags, fat16_mmap_fault, mapping)) {
+        return NULL;
+    }
+    
+    mapping->proc = proc;
+    mapping->first_cluster = entry.cluster_low;
+    mapping->file_size = entry.file_size;
+    mapping->size = size;
+    mapping->flags = flags;
+    return (void*)base;
+}
+
+int fat16_msync(void* addr) {
+    fat16_mapping_t* mapping = fat16_find_mapping(addr);
+    return mapping ? fat16_mapping_writeback(mapping) : 0;
+}
+
+int fat16_munmap(void* addr) {
+    fat16_mapping_t* mapping = fat16_find_mapping(addr);
+    return mapping ? fat16_mapping_release(mapping) : 0;
+}
+
+// Write back and drop every mapping a process holds (called from
+// process_terminate)
+void fat16_munmap_process(process_t* proc) {
+    for (int i = 0; i < FAT16_MMAP_MAX; i++) {
+        if (fat16_mappings[i].proc == proc) {
+            fat16_mapping_release(&fat16_mappings[i]);
+        }
+    }
+}
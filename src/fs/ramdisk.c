@@ -13,8 +13,8 @@ int ramdisk_init(void) {
         return 1; // Already initialized
     }
     
-    // Allocate memory for the ramdisk
-    ramdisk.data = (uint8_t*)kmalloc(RAMDISK_SIZE);
+    // Allocate cleared memory for the ramdisk
+    ramdisk.data = (uint8_t*)kzalloc(RAMDISK_SIZE);
     if (!ramdisk.data) {
         terminal_writestring("ERROR: Failed to allocate ramdisk memory\n");
         return 0;
@@ -26,9 +26,6 @@ int ramdisk_init(void) {
     ramdisk.sector_count = RAMDISK_SECTOR_COUNT;
     ramdisk.initialized = 1;
     
-    // Clear the ramdisk
-    memset(ramdisk.data, 0, RAMDISK_SIZE);
-    
     terminal_writestring("Ramdisk initialized: ");
     char buffer[32];
     uint32_to_string(RAMDISK_SIZE, buffer);
@@ -2,12 +2,15 @@
 #define ATA_H
 #include "types.h"
 
+#define ATA_SECTOR_SIZE 512
+
 // Disk info struct
 typedef struct {
     uint16_t io_base;
     uint16_t ctrl_base;
     int is_slave;
-    char model[21];
+    char model[41];
+    uint32_t sectors;                // Addressable with 28-bit LBA
     int present;
 } ata_disk_t;
 
@@ -16,4 +19,12 @@ extern int ata_disk_count;
 
 void ata_detect_disks();
 
+// Polled PIO transfers of 1-255 sectors. Return 1 on success, 0 on a
+// device error, timeout or out-of-range request.
+int ata_read_sectors(ata_disk_t* disk, uint32_t lba, uint8_t count, void* buffer);
+int ata_write_sectors(ata_disk_t* disk, uint32_t lba, uint8_t count, const void* buffer);
+
+// Writes may sit in the drive's cache until this returns
+int ata_flush(ata_disk_t* disk);
+
 #endif // ATA_H
@@ -0,0 +1,50 @@
+#ifndef BUDDY_H
+#define BUDDY_H
+
+#include "types.h"
+
+// Binary buddy allocator constants
+#define BUDDY_PAGE_SHIFT 12
+#define BUDDY_PAGE_SIZE  (1 << BUDDY_PAGE_SHIFT)  // 4KB minimum block
+#define BUDDY_MAX_ORDER  10                       // Largest block: 4MB
+
+// Per-page metadata flags
+#define BUDDY_PAGE_HEAD 0x1   // Page starts a block
+#define BUDDY_PAGE_FREE 0x2   // Block is on a free list
+
+// Free blocks are linked through their first bytes
+typedef struct buddy_block {
+    struct buddy_block* next;
+    struct buddy_block* prev;
+} buddy_block_t;
+
+// Metadata for one page; only meaningful for the first page of a block
+typedef struct {
+    uint8_t order;            // Order of the block starting at this page
+    uint8_t flags;            // BUDDY_PAGE_HEAD | BUDDY_PAGE_FREE
+} buddy_page_t;
+
+// A contiguous, page-aligned region managed as power-of-two blocks
+typedef struct {
+    uintptr_t base;                               // First byte of the region
+    size_t page_count;                            // Pages in the region
+    buddy_page_t* pages;                          // One entry per page
+    buddy_block_t* free_lists[BUDDY_MAX_ORDER + 1];
+    size_t free_pages;                            // Pages on the free lists
+    size_t free_blocks[BUDDY_MAX_ORDER + 1];      // Blocks on each free list
+} buddy_zone_t;
+
+// Buddy allocator functions
+void buddy_init(buddy_zone_t* zone, void* base, size_t size, buddy_page_t* page_map);
+void* buddy_alloc(buddy_zone_t* zone, int order);
+int buddy_free(buddy_zone_t* zone, void* ptr);
+int buddy_resize(buddy_zone_t* zone, void* ptr, int order);
+int buddy_owns(const buddy_zone_t* zone, const void* ptr);
+size_t buddy_block_size(const buddy_zone_t* zone, const void* ptr);
+int buddy_order_for_size(size_t size);
+int buddy_largest_free_order(const buddy_zone_t* zone);
+
+// Buddy debugging functions
+void buddy_print_stats(const buddy_zone_t* zone);
+
+#endif // BUDDY_H
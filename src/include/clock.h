@@ -0,0 +1,18 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "types.h"
+
+// TSC calibration: PIT channel 2 is run one-shot for this long while the
+// TSC is sampled at both ends
+#define CLOCK_CALIBRATE_MS 10
+
+// High-resolution clock from the TSC, calibrated against the PIT at boot
+void clock_init(void);
+uint64_t clock_cycles(void);
+uint64_t clock_ns(void);
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+uint64_t clock_tsc_hz(void);
+int clock_tsc_invariant(void);
+
+#endif // CLOCK_H
@@ -39,9 +39,21 @@ command_result_t command_register(const command_info_t* info);
 void command_list_available(void);
 const command_info_t* command_get_info(const char* name);
 
+// Command line parsing limits
+#define COMMAND_MAX_ARGS 32              // Arguments kept per command line
+#define COMMAND_MAX_LINE 256             // Longest command line that can be parsed
+
+// Parsed command line: the argv array and the argument strings share one
+// slab object, so parsing costs a single allocation
+typedef struct {
+    char* argv[COMMAND_MAX_ARGS + 1];    // Must stay first: argv points here
+    char strings[COMMAND_MAX_LINE];      // NUL-separated argument storage
+} command_args_t;
+
 // Command line parsing utilities
 int command_parse_args(const char* input, char*** argv_out);
 void command_free_args(int argc, char** argv);
+char* command_join_args(int argc, char** argv, int first);
 
 // Command help utilities
 int command_check_help_flag(int argc, char** argv);
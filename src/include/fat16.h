@@ -2,6 +2,9 @@
 #define FAT16_H
 
 #include "kernel.h"
+#include "vmm.h"
+
+struct process;
 
 // FAT16 Constants
 #define FAT16_SECTOR_SIZE 512
@@ -9,6 +12,14 @@
 #define FAT16_ROOT_ENTRIES 512
 #define FAT16_MEDIA_BYTE 0xF8   // Fixed disk
 #define FAT16_SIGNATURE 0xAA55
+#define FAT16_MAX_PATH 256       // Longest path (and path component) handled
+
+// Memory-mapped files live in the user half of the mapping process, one
+// slot per mapping above the shared memory objects
+#define FAT16_MMAP_BASE      (VMM_USER_BASE + 0x40000000ULL)
+#define FAT16_MMAP_SLOT_SIZE (1024 * 1024)   // Largest file that can be mapped
+#define FAT16_MMAP_MAX       16
+#define FAT16_MAP_WRITE      0x01            // Writable; dirty pages are written back
 
 // FAT16 Boot sector structure
 typedef struct __attribute__((packed)) {
@@ -75,12 +86,22 @@ int fat16_read_file(const char* filename, void* buffer, size_t max_size);
 int fat16_delete_file(const char* filename);
 int fat16_list_files(void);
 int fat16_get_file_size(const char* filename);
+int fat16_find_entry(const char* filename, fat16_dir_entry_t* entry);
+
+// Memory-mapped files, for the current process. Pages are read in when
+// first touched; fat16_msync and fat16_munmap write dirty pages back.
+void* fat16_mmap(const char* filename, int flags);
+int fat16_msync(void* addr);
+int fat16_munmap(void* addr);
+void fat16_munmap_process(struct process* proc);
 
 // Directory functions
 int fat16_create_directory(const char* dirname);
 int fat16_change_directory(const char* path);
 int fat16_list_directory(const char* path);
 char* fat16_get_current_directory(void);
+int fat16_parse_path(const char* path, char* components[], int max_components);
+void fat16_free_path(char* components[], int count);
 
 // Internal FAT16 functions (simplified)
 uint16_t fat16_find_free_cluster(void);
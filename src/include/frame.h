@@ -0,0 +1,58 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "types.h"
+#include "multiboot.h"
+
+// Physical frame sizes
+#define FRAME_SHIFT          12
+#define FRAME_SIZE           (1 << FRAME_SHIFT)           // 4KB frame
+#define FRAME_LARGE_SHIFT    21
+#define FRAME_LARGE_SIZE     (1 << FRAME_LARGE_SHIFT)     // 2MB frame
+#define FRAMES_PER_LARGE     (FRAME_LARGE_SIZE / FRAME_SIZE)
+
+// Physical memory tracked by the bitmap (frames above are ignored)
+#define FRAME_MAX_MEMORY     0x100000000ULL               // 4GB
+#define FRAME_MAX_COUNT      (FRAME_MAX_MEMORY >> FRAME_SHIFT)
+
+// Memory reachable through the boot identity map. vmm_init extends the
+// map over all RAM; see vmm_identity_limit for the current bound.
+#define FRAME_IDENTITY_LIMIT 0x40000000ULL                // 1GB
+
+// Recently freed 4KB frames kept for O(1) reuse
+#define FRAME_CACHE_SIZE     64
+
+// Frames zeroed ahead of time by the idle loop, and how many it clears
+// per call so it stays responsive
+#define FRAME_ZERO_POOL_SIZE 256
+#define FRAME_ZERO_BATCH     4
+
+// Frames mapped in more than one place (copy-on-write) that can carry a
+// reference count; must be a power of two
+#define FRAME_SHARED_MAX     4096
+
+// Physical frame allocator functions. Addresses are physical; 0 means
+// failure (frame 0 is always reserved).
+void frame_init(uint32_t multiboot_magic, uint32_t multiboot_info);
+uint64_t frame_alloc(void);
+uint64_t frame_alloc_zeroed(void);
+void frame_free(uint64_t addr);
+size_t frame_zero_idle(size_t max_frames);
+uint64_t frame_alloc_large(void);
+void frame_free_large(uint64_t addr);
+uint64_t frame_alloc_contiguous(size_t large_count, uint64_t limit);
+void frame_free_contiguous(uint64_t addr, size_t large_count);
+
+// Shared 4KB frames. frame_share adds a reference (0 if the table is
+// full); frame_free drops one and only frees the frame with the last.
+int frame_share(uint64_t addr);
+uint32_t frame_ref_count(uint64_t addr);
+
+// Frame statistics
+size_t frame_total_count(void);
+size_t frame_free_count(void);
+uint64_t frame_memory_top(void);
+size_t frame_shared_count(void);
+void frame_print_stats(void);
+
+#endif // FRAME_H
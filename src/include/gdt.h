@@ -0,0 +1,33 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include "types.h"
+
+// Segment selectors. The code selector matches the boot GDT, so CS does
+// not need reloading when the runtime GDT replaces it.
+#define GDT_KERNEL_CODE 0x08
+#define GDT_KERNEL_DATA 0x10
+#define GDT_TSS         0x18
+
+// Interrupt stack table slots (1-based, as stored in IDT entries). Faults
+// that can hit a broken stack switch to a known-good one.
+#define IST_PAGE_FAULT    1
+#define IST_DOUBLE_FAULT  2
+#define IST_IRQ           3      // Process stacks are demand-paged
+#define IST_STACK_SIZE    16384
+
+// 64-bit task state segment: only the interrupt stack table is used
+typedef struct __attribute__((packed)) {
+    uint32_t reserved0;
+    uint64_t rsp[3];                 // Stacks for privilege changes (unused)
+    uint64_t reserved1;
+    uint64_t ist[7];                 // Interrupt stack table
+    uint64_t reserved2;
+    uint16_t reserved3;
+    uint16_t iomap_base;
+} tss_t;
+
+// GDT functions
+void gdt_init(void);
+
+#endif // GDT_H
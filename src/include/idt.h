@@ -0,0 +1,35 @@
+#ifndef IDT_H
+#define IDT_H
+
+#include "types.h"
+
+#define IDT_ENTRIES     256
+#define IDT_EXCEPTIONS  32
+#define IDT_STUBS       48           // Exceptions, then the 16 PIC IRQs
+
+// Exception vectors with dedicated handling
+#define IDT_VECTOR_DOUBLE_FAULT       8
+#define IDT_VECTOR_GENERAL_PROTECTION 13
+#define IDT_VECTOR_PAGE_FAULT         14
+
+// Page fault error code bits
+#define PAGE_FAULT_PRESENT  0x1      // Protection violation (page was present)
+#define PAGE_FAULT_WRITE    0x2      // Caused by a write
+#define PAGE_FAULT_FETCH    0x10     // Caused by an instruction fetch
+
+// Registers as saved by the entry stubs in boot.asm, lowest address first
+typedef struct {
+    uint64_t r15, r14, r13, r12, r11, r10, r9, r8;
+    uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax;
+    uint64_t vector, error_code;
+    uint64_t rip, cs, rflags, rsp, ss;   // Pushed by the CPU
+} interrupt_frame_t;
+
+typedef void (*interrupt_handler_t)(interrupt_frame_t* frame);
+
+// Interrupt descriptor table functions
+void idt_init(void);
+void idt_register_handler(uint8_t vector, interrupt_handler_t handler);
+void idt_panic(interrupt_frame_t* frame, const char* message);
+
+#endif // IDT_H
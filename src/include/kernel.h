@@ -16,6 +16,6 @@ extern char bss_start[];
 extern char bss_end[];
 
 // Function declarations
-void kernel_main(void);
+void kernel_main(uint32_t multiboot_magic, uint32_t multiboot_info);
 
 #endif // KERNEL_H
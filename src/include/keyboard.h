@@ -18,7 +18,13 @@
 #define LEFT_SHIFT_RELEASE 0xAA
 #define RIGHT_SHIFT_RELEASE 0xB6
 
+// Scancodes buffered between interrupts and readers; a power of two
+#define KEYBOARD_BUFFER_SIZE 256
+
+struct process;
+
 void keyboard_init();
+void keyboard_release_process(struct process* proc);
 char keyboard_getchar();
 int keyboard_has_input();
 unsigned char keyboard_read_scancode();
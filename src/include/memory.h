@@ -2,24 +2,169 @@
 #define MEMORY_H
 
 #include "kernel.h"
+#include "buddy.h"
 
-// Memory block structure for our simple allocator
+// Memory block header for the two-level segregated-fit (TLSF) allocator.
+// The low bits of size carry boundary-tag flags: whether this block is free
+// and whether the physically preceding block is free. A free block stores
+// its size again in the last word of its payload (the footer), so a block
+// whose predecessor is free can find it without a list walk. The free-list
+// links overlay the payload and only exist while the block is free.
 typedef struct memory_block {
-    size_t size;
-    int is_free;
-    struct memory_block* next;
+    size_t size;                          // Payload size | MEMORY_BLOCK_FREE | MEMORY_BLOCK_PREV_FREE
+    uint32_t magic;                       // MEMORY_MAGIC_USED or MEMORY_MAGIC_FREE
+    uint32_t reserved;
+    struct memory_block* next_free;       // Free-list links (only valid while free)
+    struct memory_block* prev_free;
 } memory_block_t;
 
+// Boundary-tag flag bits stored in memory_block_t.size
+#define MEMORY_BLOCK_FREE      0x1
+#define MEMORY_BLOCK_PREV_FREE 0x2
+#define MEMORY_BLOCK_FLAGS     (MEMORY_BLOCK_FREE | MEMORY_BLOCK_PREV_FREE)
+
+// Header magic values, used to reject double frees and stray pointers
+#define MEMORY_MAGIC_USED 0xA110CA7E
+#define MEMORY_MAGIC_FREE 0xF4EEB10C
+
 // Memory management constants
 #define MEMORY_POOL_SIZE 1024 * 1024  // 1MB memory pool
-#define MEMORY_BLOCK_SIZE sizeof(memory_block_t)
+#define MEMORY_BLOCK_SIZE (2 * sizeof(size_t))  // Header without the free-list links
+
+// The pool is managed by a buddy allocator. Requests of at least
+// MEMORY_LARGE_ALLOC bytes get their own buddy block; smaller ones come from
+// TLSF heap arenas that are themselves carved out of buddy blocks.
+#define MEMORY_LARGE_ALLOC      BUDDY_PAGE_SIZE
+#define MEMORY_HEAP_ARENA_SIZE  (64 * 1024)   // Size of each TLSF arena
+#define MEMORY_MAX_ARENAS       16
+#define MEMORY_MAX_ALLOC        (BUDDY_PAGE_SIZE << BUDDY_MAX_ORDER)
+
+// Buddy zones: the static pool plus physical memory regions added at boot
+#define MEMORY_MAX_ZONES        4
+#define MEMORY_REGION_MAX_SIZE  (64 * 1024 * 1024)
+
+// TLSF geometry: sizes are split into power-of-two first-level classes,
+// each subdivided into 2^MEMORY_SL_INDEX_COUNT_LOG2 linear second-level lists
+#define MEMORY_ALIGN_LOG2          4   // 16-byte default alignment (SysV ABI)
+#define MEMORY_ALIGN               (1 << MEMORY_ALIGN_LOG2)
+#define MEMORY_SL_INDEX_COUNT_LOG2 5
+#define MEMORY_SL_INDEX_COUNT      (1 << MEMORY_SL_INDEX_COUNT_LOG2)
+#define MEMORY_FL_INDEX_SHIFT      (MEMORY_SL_INDEX_COUNT_LOG2 + MEMORY_ALIGN_LOG2)
+#define MEMORY_FL_INDEX_MAX        16  // Largest class covers a whole heap arena
+#define MEMORY_FL_INDEX_COUNT      (MEMORY_FL_INDEX_MAX - MEMORY_FL_INDEX_SHIFT + 1)
+#define MEMORY_SMALL_BLOCK_SIZE    (1 << MEMORY_FL_INDEX_SHIFT)
+#define MEMORY_MIN_BLOCK_SIZE      32  // Free-list links plus footer, rounded to MEMORY_ALIGN
+
+// Common alignment classes for kmalloc_aligned
+#define MEMORY_SSE_ALIGN           16
+#define MEMORY_CACHE_LINE_SIZE     64
+#define MEMORY_PAGE_SIZE           BUDDY_PAGE_SIZE
+
+// Heap telemetry, maintained incrementally so reading it is cheap
+#define MEMORY_HISTOGRAM_MIN_SHIFT 4   // First bucket: free blocks of 16-31 bytes
+#define MEMORY_HISTOGRAM_BUCKETS   17  // Last bucket: 1MB and up
+
+typedef struct {
+    size_t total_bytes;            // Bytes managed by all buddy zones
+    size_t allocated_bytes;        // Block bytes held by live allocations
+    size_t peak_allocated;         // Highest allocated_bytes seen
+    size_t free_bytes;             // Heap free-list bytes plus free buddy pages
+    size_t largest_free;           // Largest single free block
+    uint32_t active_allocations;   // Live allocations
+    uint32_t alloc_count;          // Allocations served since boot
+    uint32_t free_count;           // Frees since boot
+    uint32_t fragmentation;        // 100 * (1 - largest_free / free_bytes)
+    uint32_t free_histogram[MEMORY_HISTOGRAM_BUCKETS]; // Free blocks by power-of-two size
+} memory_stats_t;
+
+// Allocation call-site profiling, enabled at build time with
+// make MEMORY_PROFILE=1. When disabled the hooks compile to nothing.
+#ifndef MEMORY_PROFILE
+#define MEMORY_PROFILE 0
+#endif
+
+#define MEMORY_PROFILE_SITES 128   // Hash table size (power of two)
+
+// Sort keys for memory_profile_print
+typedef enum {
+    MEMORY_PROFILE_BY_BYTES,       // Live bytes
+    MEMORY_PROFILE_BY_COUNT,       // Allocations made
+    MEMORY_PROFILE_BY_CHURN        // Allocations freed again
+} memory_profile_sort_t;
+
+// Per-call-site allocation statistics
+typedef struct {
+    void* caller;                  // Return address of the kmalloc call
+    uint32_t alloc_count;          // Allocations made from this site
+    uint32_t free_count;           // Of those, how many were freed
+    size_t live_bytes;             // Block bytes currently held
+    size_t peak_bytes;             // Highest live_bytes seen
+    size_t total_bytes;            // Block bytes ever allocated
+    size_t min_size;               // Smallest requested size
+    size_t max_size;               // Largest requested size
+} memory_site_t;
+
+// Allocation tracing for offline replay, enabled at build time with
+// make MEMORY_TRACE=1 and started at run time with 'memtrace start'
+#ifndef MEMORY_TRACE
+#define MEMORY_TRACE 0
+#endif
+
+#define MEMORY_TRACE_ENTRIES 1024      // Ring buffer size (power of two)
+#define MEMORY_TRACE_MAGIC   "MTRC"
+#define MEMORY_TRACE_VERSION 1
+
+typedef enum {
+    MEMORY_TRACE_ALLOC = 1,            // kmalloc / kmalloc_aligned
+    MEMORY_TRACE_FREE = 2,             // kfree
+    MEMORY_TRACE_REALLOC = 3           // krealloc
+} memory_trace_op_t;
+
+// One traced call. Pointers are recorded as ids (zone index in the top
+// byte, zone offset in MEMORY_ALIGN units below, plus one) that are unique
+// among live blocks; 0 is NULL.
+typedef struct {
+    uint64_t timestamp;                // TSC at the call
+    uint32_t id;                       // Block returned (or freed)
+    uint32_t old_id;                   // Block passed to krealloc
+    uint32_t size;                     // Requested size
+    uint16_t align;                    // Requested alignment (0 = default)
+    uint8_t op;                        // memory_trace_op_t
+    uint8_t reserved;
+} memory_trace_entry_t;
+
+// Trace file layout: this header followed by count entries, oldest first
+typedef struct {
+    char magic[4];                     // MEMORY_TRACE_MAGIC
+    uint32_t version;                  // MEMORY_TRACE_VERSION
+    uint32_t count;                    // Entries that follow
+    uint32_t dropped;                  // Older entries overwritten in the ring
+} memory_trace_header_t;
 
 // Memory management functions
 void memory_init(void);
+int memory_add_region(void* base, size_t size);
 void* kmalloc(size_t size);
+void* kzalloc(size_t size);
 void kfree(void* ptr);
+void* krealloc(void* ptr, size_t size);
+void* kmalloc_aligned(size_t size, size_t align);
+void kfree_aligned(void* ptr);
 
 // Memory debugging functions
+void memory_get_stats(memory_stats_t* stats);
 void memory_print_stats(void);
+void memory_profile_print(memory_profile_sort_t sort, int limit);
+
+// Allocation trace functions (no-ops unless built with MEMORY_TRACE)
+void memory_trace_start(void);
+void memory_trace_stop(void);
+int memory_trace_enabled(void);
+size_t memory_trace_size(void);
+size_t memory_trace_export(void* buffer, size_t size);
+
+#ifdef MEMORY_HOSTED
+void memory_hosted_reset(void);
+#endif
 
 #endif // MEMORY_H
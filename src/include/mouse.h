@@ -3,8 +3,23 @@
 
 #include "types.h"
 
+// Packets queued between the IRQ handler and mouse_update; a power of two
+#define MOUSE_QUEUE_SIZE 64
+
+// Without a frame loop, queued motion is drawn at most this often (~70Hz)
+#define MOUSE_REFRESH_MS 14
+
+typedef struct {
+    int16_t dx;
+    int16_t dy;                      // Screen direction (down is positive)
+    uint8_t buttons;
+} mouse_packet_t;
+
 void mouse_init();
 void mouse_handle_byte(uint8_t data);
+int mouse_has_motion();
+void mouse_update(int screen_redrawn);
+void mouse_refresh();
 int mouse_get_x();
 int mouse_get_y();
 int mouse_get_buttons();
@@ -0,0 +1,53 @@
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include "types.h"
+
+// Value left in eax by a Multiboot-compliant boot loader
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+
+// multiboot_info_t.flags bits
+#define MULTIBOOT_INFO_MEMORY   0x001   // mem_lower/mem_upper are valid
+#define MULTIBOOT_INFO_CMDLINE  0x004   // cmdline is valid
+#define MULTIBOOT_INFO_MODS     0x008   // mods_count/mods_addr are valid
+#define MULTIBOOT_INFO_MEM_MAP  0x040   // mmap_length/mmap_addr are valid
+
+// Memory map entry types
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+// Boot information passed in ebx (all addresses are physical)
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower;          // KB of memory below 1MB
+    uint32_t mem_upper;          // KB of memory above 1MB
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;        // Bytes of memory map
+    uint32_t mmap_addr;
+    uint32_t drives_length;
+    uint32_t drives_addr;
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+} __attribute__((packed)) multiboot_info_t;
+
+// Memory map entry; size does not include the size field itself
+typedef struct {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+// Boot module loaded alongside the kernel
+typedef struct {
+    uint32_t mod_start;
+    uint32_t mod_end;
+    uint32_t string;
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_module_t;
+
+#endif // MULTIBOOT_H
@@ -0,0 +1,24 @@
+#ifndef PIC_H
+#define PIC_H
+
+#include "types.h"
+
+// 8259 programmable interrupt controllers, remapped so IRQs 0-15 arrive
+// on vectors 32-47 instead of colliding with the CPU exceptions
+#define PIC_IRQ_BASE     32
+#define PIC_IRQ_COUNT    16
+
+// IRQ lines
+#define IRQ_TIMER        0
+#define IRQ_KEYBOARD     1
+#define IRQ_CASCADE      2               // Slave PIC
+#define IRQ_MOUSE        12
+
+// PIC functions. Every line starts masked; drivers unmask their own.
+void pic_init(void);
+void pic_unmask(uint8_t irq);
+void pic_mask(uint8_t irq);
+void pic_send_eoi(uint8_t irq);
+int pic_is_spurious(uint8_t irq);
+
+#endif // PIC_H
@@ -2,6 +2,7 @@
 #define PROCESS_H
 
 #include "types.h"
+#include "vmm.h"
 
 // Process states
 typedef enum {
@@ -26,9 +27,51 @@ typedef struct {
     uint64_t r8, r9, r10, r11, r12, r13, r14, r15;
     uint64_t rip;
     uint64_t rflags;
-    uint64_t cr3;  // Page directory
+    uint64_t cr3;  // Address space: PML4 | PCID | no-flush bit
 } cpu_context_t;
 
+// Per-process arena chunk header. The first chunk is the process memory
+// region; proc_alloc chains extra heap chunks in front of it when it fills.
+typedef struct proc_chunk {
+    struct proc_chunk* next;         // Previously filled chunk
+    size_t size;                     // Chunk size, header included
+} proc_chunk_t;
+
+// Process arena constants
+#define PROC_MEMORY_SIZE       (64 * 1024)   // Initial per-process region
+#define PROC_ARENA_CHUNK_SIZE  (16 * 1024)   // Minimum size of a spill chunk
+#define PROC_ARENA_ALIGN       16
+
+// Process stacks and memory regions are reserved in a kernel window shared
+// by all address spaces, one slot per process, and backed by frames on
+// first touch. Each slot starts with an unmapped guard page below the
+// stack; the memory region sits at the top of the slot.
+#define PROC_VM_BASE           0xFFFF810000000000ULL
+#define PROC_VM_SLOT_SIZE      (512 * 1024)
+#define PROC_VM_SLOTS          1024
+#define PROC_GUARD_SIZE        4096
+#define PROC_STACK_MAX         (PROC_VM_SLOT_SIZE - PROC_MEMORY_SIZE - 2 * PROC_GUARD_SIZE)
+#define PROC_MAX_VMAS          8
+
+struct process;
+struct vm_area;
+
+// Pages in a memory area that are not anonymous memory. Called for every
+// fault in the area with the IDT error code; returns 1 if it was handled.
+typedef int (*vm_fault_handler_t)(struct process* proc, struct vm_area* vma,
+                                  uint64_t page, uint64_t error_code);
+
+// A reserved virtual range, backed page by page when it is touched.
+// Areas in the process window without a fault handler are anonymous
+// memory; user-half areas must have one.
+typedef struct vm_area {
+    uint64_t start;
+    uint64_t end;
+    uint32_t flags;                  // VMM_MAP_* for faulted-in pages
+    vm_fault_handler_t fault;        // NULL for anonymous memory
+    void* data;                      // Owned by the fault handler
+} vm_area_t;
+
 // Process Control Block (PCB)
 typedef struct process {
     uint32_t pid;                    // Process ID
@@ -43,11 +86,23 @@ typedef struct process {
     // Memory management
     void* memory_base;               // Process memory base address
     size_t memory_size;              // Process memory size
+    proc_chunk_t* arena_chunk;       // Arena chunk being bump-allocated from
+    size_t arena_offset;             // Next free byte in arena_chunk
+    address_space_t* address_space;  // Page tables this process runs on
+    uint32_t vm_slot;                // Slot in the process window
+    vm_area_t vmas[PROC_MAX_VMAS];   // Demand-paged regions
+    int vma_count;
+    size_t resident_pages;           // Frames faulted in
+    size_t swapped_pages;            // Pages written out to swap
+    uint32_t cow_shared;             // Pages shared with the parent at clone
+    uint32_t cow_faults;             // Writes to read-only shared pages
     
     // Time tracking
     uint64_t time_slice;             // Time slice in milliseconds
     uint64_t time_used;              // Time used in current slice
     uint64_t total_time;             // Total CPU time used
+    uint64_t wake_tick;              // Timer tick that ends process_sleep
+    struct process* sleep_next;      // Next in the sleep queue
     
     struct process* parent;          // Parent process
     struct process* next;            // Next process in list
@@ -63,10 +118,21 @@ typedef void (*process_entry_t)(void* args);
 void process_init(void);
 process_t* process_create(const char* name, process_entry_t entry, void* args, 
                          process_priority_t priority, size_t stack_size);
+process_t* process_clone(process_t* parent, const char* name, process_entry_t entry, void* args);
 void process_terminate(process_t* proc, int exit_code);
+
+// Memory areas paged in by a fault handler (see vm_area_t)
+int process_map_area(process_t* proc, uint64_t start, uint64_t end, uint32_t flags,
+                     vm_fault_handler_t fault, void* data);
+void process_unmap_area(process_t* proc, uint64_t start);
 void process_yield(void);
 void process_schedule(void);
 void process_sleep(uint64_t milliseconds);
+void process_wake_sleepers(uint64_t now);
+
+// Per-process arena: bump allocation released all at once
+void* proc_alloc(size_t size);
+void proc_reset(void);
 
 // Current process access
 extern process_t* current_process;
@@ -90,4 +156,7 @@ void shell_process_main(void* args);
 uint32_t process_generate_pid(void);
 void process_cleanup_terminated(void);
 
+// Page out up to count cold anonymous process pages; returns frames freed
+size_t process_swap_out(size_t count);
+
 #endif // PROCESS_H
@@ -0,0 +1,37 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include "types.h"
+#include "vmm.h"
+
+struct process;
+
+// Named shared-memory objects. Each object owns its frames and is mapped
+// at the same user-half address in every process that maps it, so
+// pointers into a shared region mean the same thing in all of them.
+#define SHM_NAME_MAX      32
+#define SHM_MAX_OBJECTS   32
+#define SHM_MAX_MAPPINGS  128                       // Across all processes
+#define SHM_MAX_SIZE      (1024 * 1024)             // Per object
+#define SHM_BASE          VMM_USER_BASE             // Object i at SHM_BASE + i * SHM_MAX_SIZE
+
+typedef struct {
+    char name[SHM_NAME_MAX];
+    size_t size;                     // Bytes, a whole number of pages
+    uint64_t* frames;                // Physical frame of each page
+    uint32_t refcount;               // Processes mapping the object
+} shm_object_t;
+
+// Shared memory functions, acting on the current process. An object lives
+// while at least one process maps it; the last unmap frees its frames.
+void* shm_create(const char* name, size_t size);
+void* shm_map(const char* name);
+int shm_unmap(void* addr);
+
+// Drop every mapping a process holds (called from process_terminate)
+void shm_release_process(struct process* proc);
+
+// Shared memory information
+void shm_list(void);
+
+#endif // SHM_H
@@ -0,0 +1,53 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "types.h"
+
+// Object cache constructor, run once when an object is first carved out of
+// a new slab. Objects must be returned to the cache in constructed state.
+typedef void (*kmem_ctor_t)(void* obj);
+
+// A slab is a heap chunk carved into equally sized object slots
+typedef struct kmem_slab {
+    struct kmem_slab* next;          // Next slab owned by the same cache
+} kmem_slab_t;
+
+// Object cache for one fixed-size kernel object type
+typedef struct kmem_cache {
+    char name[32];                   // Cache name (for statistics)
+    size_t object_size;              // Size requested by the creator
+    size_t slot_size;                // Object size rounded up to alignment
+    size_t align;                    // Object alignment
+    size_t link_offset;              // Where the free-list link lives in a free slot
+    size_t objects_per_slab;         // Slots carved from each slab
+    kmem_ctor_t ctor;                // Optional constructor
+
+    void* free_list;                 // Free objects, linked through link_offset
+    kmem_slab_t* slabs;              // Slabs owned by this cache
+
+    // Statistics
+    uint32_t slab_count;             // Slabs allocated from the heap
+    uint32_t objects_total;          // Object slots across all slabs
+    uint32_t objects_in_use;         // Objects currently handed out
+    uint32_t alloc_count;            // Total kmem_cache_alloc calls served
+    uint32_t free_count;             // Total kmem_cache_free calls
+
+    int in_use;                      // Cache slot is allocated
+} kmem_cache_t;
+
+// Slab allocator constants
+#define KMEM_MAX_CACHES     32       // Fixed-size cache descriptor pool
+#define KMEM_SLAB_SIZE      4096     // Default slab size
+#define KMEM_MIN_OBJECTS    8        // Minimum objects per slab for large objects
+#define KMEM_MIN_ALIGN      sizeof(void*)
+
+// Slab allocator functions
+kmem_cache_t* kmem_cache_create(const char* name, size_t size, size_t align, kmem_ctor_t ctor);
+void kmem_cache_destroy(kmem_cache_t* cache);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+
+// Slab debugging functions
+void kmem_cache_print_stats(void);
+
+#endif // SLAB_H
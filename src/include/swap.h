@@ -0,0 +1,28 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "types.h"
+#include "ata.h"
+
+// Swap area on an ATA disk: a run of page-sized slots starting at a
+// chosen LBA. Swapped-out pages keep their slot in the page table entry
+// (see vmm_set_swap_entry).
+#define SWAP_MAX_PAGES         16384         // 64MB of swap slots
+#define SWAP_SECTORS_PER_PAGE  (4096 / ATA_SECTOR_SIZE)
+
+// Pages evicted per reclaim when the frame allocator runs dry; the swap
+// disk is flushed once per batch before their frames are freed
+#define SWAP_EVICT_BATCH       16
+
+// Swap functions. Entries are never 0 and leave the present bit clear.
+int swap_on(ata_disk_t* disk, uint32_t start_lba, uint32_t pages);
+int swap_enabled(void);
+uint64_t swap_write_page(const void* page);
+int swap_sync(void);
+int swap_read_page(uint64_t entry, void* page);
+void swap_free_entry(uint64_t entry);
+
+// Swap statistics
+void swap_print_stats(void);
+
+#endif // SWAP_H
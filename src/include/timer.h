@@ -8,7 +8,14 @@
 #define PIT_CH0_PORT 0x40
 #define PIT_FREQ 1193182
 
+// System tick: PIT channel 0 interrupts TIMER_HZ times a second
+#define TIMER_HZ 1000
+#define TIMER_DIVISOR ((PIT_FREQ + TIMER_HZ / 2) / TIMER_HZ)
+
 void timer_init();
-uint16_t timer_read_count();
+
+// Monotonic time since timer_init
+uint64_t timer_ticks();
+uint64_t timer_ms();
 
 #endif // TIMER_H
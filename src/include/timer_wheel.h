@@ -0,0 +1,44 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "types.h"
+
+// Hierarchical timer wheel driven by the system tick. The root level has
+// one slot per tick for the next 256 ticks; each outer level has 64 slots
+// covering 64 times the span of the level inside it, and its timers
+// cascade inward as the tick reaches them. Insert and cancel are O(1).
+#define TIMER_ROOT_BITS    8
+#define TIMER_ROOT_SIZE    (1 << TIMER_ROOT_BITS)
+#define TIMER_LEVEL_BITS   6
+#define TIMER_LEVEL_SIZE   (1 << TIMER_LEVEL_BITS)
+#define TIMER_OUTER_LEVELS 3
+#define TIMER_MAX_DELAY    ((1ULL << (TIMER_ROOT_BITS + TIMER_OUTER_LEVELS * TIMER_LEVEL_BITS)) - 1)
+
+typedef void (*timer_callback_t)(void* data);
+
+// A kernel timer, owned by the caller and linked into a wheel slot while
+// pending. Callbacks run in the tick interrupt: they must not block, but
+// may add, modify or cancel timers, their own included.
+typedef struct ktimer {
+    struct ktimer* next;
+    struct ktimer** pprev;           // Link pointing at this timer; NULL when idle
+    uint64_t expires;                // Tick it fires on
+    timer_callback_t callback;
+    void* data;
+} ktimer_t;
+
+// Timer functions. Delays are in ticks (milliseconds at TIMER_HZ 1000);
+// longer delays than TIMER_MAX_DELAY are clamped.
+void timer_setup(ktimer_t* timer, timer_callback_t callback, void* data);
+void timer_add(ktimer_t* timer, uint64_t delay);
+int timer_mod(ktimer_t* timer, uint64_t delay);
+int timer_cancel(ktimer_t* timer);
+int timer_pending(const ktimer_t* timer);
+
+// Fire everything due up to tick now (called from the timer IRQ)
+void timer_wheel_run(uint64_t now);
+
+// Timer wheel statistics
+void timer_wheel_print_stats(void);
+
+#endif // TIMER_WHEEL_H
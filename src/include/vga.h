@@ -15,6 +15,7 @@
 #define VGA_GFX_WIDTH 320
 #define VGA_GFX_HEIGHT 200
 #define VGA_MEMORY 0xA0000
+#define VGA_MEMORY_SIZE 0x10000  // Mode 13h window, mapped write-combining
 
 // VGA registers
 #define VGA_AC_INDEX        0x3C0
@@ -0,0 +1,98 @@
+#ifndef VMM_H
+#define VMM_H
+
+#include "types.h"
+
+// Page sizes at each level of the 4-level tables
+#define VMM_PAGE_SIZE        0x1000ULL        // 4KB (page table entry)
+#define VMM_LARGE_PAGE_SIZE  0x200000ULL      // 2MB (page directory entry)
+#define VMM_HUGE_PAGE_SIZE   0x40000000ULL    // 1GB (PDPT entry, if supported)
+#define VMM_ENTRIES          512
+
+// Hardware page table entry bits
+#define VMM_PTE_PRESENT      (1ULL << 0)
+#define VMM_PTE_WRITE        (1ULL << 1)
+#define VMM_PTE_USER         (1ULL << 2)
+#define VMM_PTE_PWT          (1ULL << 3)
+#define VMM_PTE_PCD          (1ULL << 4)
+#define VMM_PTE_ACCESSED     (1ULL << 5)
+#define VMM_PTE_LARGE        (1ULL << 7)      // 2MB/1GB leaf
+#define VMM_PTE_PAT          (1ULL << 7)      // PAT index bit 2 in 4KB entries
+#define VMM_PTE_PAT_LARGE    (1ULL << 12)     // PAT index bit 2 in 2MB/1GB entries
+#define VMM_PTE_GLOBAL       (1ULL << 8)
+#define VMM_PTE_NX           (1ULL << 63)
+#define VMM_PTE_ADDR_MASK    0x000FFFFFFFFFF000ULL
+
+// CR3 with PCIDs: the low 12 bits tag TLB entries with the address space,
+// and bit 63 keeps that space's cached entries when CR3 is loaded
+#define VMM_PCID_COUNT       4096
+#define VMM_CR3_NOFLUSH      (1ULL << 63)
+
+// PML4 split: entry 0 (the identity map) and the upper half belong to the
+// kernel and are shared by every address space; the rest is per process
+#define VMM_USER_BASE        0x0000008000000000ULL
+#define VMM_USER_TOP         0x0000800000000000ULL
+
+// Mapping flags for vmm_map and vmm_protect
+#define VMM_MAP_WRITE        0x01
+#define VMM_MAP_USER         0x02
+#define VMM_MAP_NOEXEC       0x04             // Ignored if the CPU lacks NX
+#define VMM_MAP_NOCACHE      0x08             // Uncached, for MMIO registers
+#define VMM_MAP_WRITETHROUGH 0x10
+#define VMM_MAP_WRITECOMBINE 0x20             // For framebuffers; uncached without PAT
+
+// PAT setup: the power-on entries, except entry 4 (PAT bit alone) which
+// becomes write-combining. Entries 0-3 keep the PWT/PCD meanings.
+#define VMM_PAT_MSR          0x277
+#define VMM_PAT_VALUE        0x0007040100070406ULL
+
+// A page-table hierarchy that processes run in. Kernel-half PML4 entries
+// point at the kernel's own tables, so kernel mappings are always shared.
+typedef struct address_space {
+    uint64_t* pml4;                  // Top-level table (identity mapped)
+    uint64_t cr3;                    // Value loaded into CR3 (PML4 | PCID | no-flush)
+    uint16_t pcid;                   // TLB tag, 0 when PCIDs are unavailable
+    uint32_t refcount;               // Processes running in this space
+    struct address_space* next;      // All user address spaces
+} address_space_t;
+
+// Kernel virtual window for vmm_map_mmio
+#define VMM_MMIO_BASE        0xFFFF800000000000ULL
+#define VMM_MMIO_SIZE        0x0000008000000000ULL  // One PML4 entry (512GB)
+
+// Ranges changing more pages than this flush the whole TLB instead of
+// using invlpg page by page
+#define VMM_INVLPG_MAX       32
+
+// Page-table management functions. Addresses and sizes must be 4KB
+// aligned; functions return 1 on success and 0 on failure.
+void vmm_init(void);
+int vmm_map(uint64_t virt, uint64_t phys, size_t size, uint32_t flags);
+int vmm_unmap(uint64_t virt, size_t size);
+int vmm_protect(uint64_t virt, size_t size, uint32_t flags);
+uint64_t vmm_translate(uint64_t virt);
+int vmm_test_accessed(uint64_t virt);
+void* vmm_map_mmio(uint64_t phys, size_t size, uint32_t flags);
+uint64_t vmm_identity_limit(void);
+
+// Swapped-out pages keep their swap location in the non-present 4KB
+// entry. Values must leave VMM_PTE_PRESENT clear; 0 means none.
+int vmm_set_swap_entry(uint64_t virt, uint64_t value);
+uint64_t vmm_swap_entry(uint64_t virt);
+int vmm_write_combining(void);
+
+// Address space functions. The space_* calls only accept user-half ranges;
+// kernel mappings go through vmm_map and are seen by every space.
+address_space_t* address_space_create(void);
+address_space_t* address_space_kernel(void);
+void address_space_retain(address_space_t* space);
+void address_space_release(address_space_t* space);
+int vmm_space_map(address_space_t* space, uint64_t virt, uint64_t phys, size_t size, uint32_t flags);
+int vmm_space_unmap(address_space_t* space, uint64_t virt, size_t size);
+int vmm_space_protect(address_space_t* space, uint64_t virt, size_t size, uint32_t flags);
+uint64_t vmm_space_translate(address_space_t* space, uint64_t virt);
+
+// Page-table debugging functions
+void vmm_print_stats(void);
+
+#endif // VMM_H
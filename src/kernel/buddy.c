@@ -0,0 +1,231 @@
+#include "buddy.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+
+static inline size_t buddy_page_index(const buddy_zone_t* zone, const void* ptr) {
+    return ((uintptr_t)ptr - zone->base) >> BUDDY_PAGE_SHIFT;
+}
+
+static inline buddy_block_t* buddy_page_block(const buddy_zone_t* zone, size_t page) {
+    return (buddy_block_t*)(zone->base + (page << BUDDY_PAGE_SHIFT));
+}
+
+static void buddy_list_push(buddy_zone_t* zone, size_t page, int order) {
+    buddy_block_t* block = buddy_page_block(zone, page);
+    buddy_block_t* head = zone->free_lists[order];
+
+    block->next = head;
+    block->prev = NULL;
+    if (head) {
+        head->prev = block;
+    }
+    zone->free_lists[order] = block;
+
+    zone->pages[page].order = (uint8_t)order;
+    zone->pages[page].flags = BUDDY_PAGE_HEAD | BUDDY_PAGE_FREE;
+    zone->free_pages += (size_t)1 << order;
+    zone->free_blocks[order]++;
+}
+
+static void buddy_list_remove(buddy_zone_t* zone, size_t page, int order) {
+    buddy_block_t* block = buddy_page_block(zone, page);
+
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        zone->free_lists[order] = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+
+    zone->pages[page].flags = 0;
+    zone->free_pages -= (size_t)1 << order;
+    zone->free_blocks[order]--;
+}
+
+// Smallest order whose block holds size bytes
+int buddy_order_for_size(size_t size) {
+    int order = 0;
+    while (((size_t)BUDDY_PAGE_SIZE << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+// Order of the largest free block, or -1 if the zone is full
+int buddy_largest_free_order(const buddy_zone_t* zone) {
+    for (int order = BUDDY_MAX_ORDER; order >= 0; order--) {
+        if (zone->free_lists[order]) {
+            return order;
+        }
+    }
+    return -1;
+}
+
+void buddy_init(buddy_zone_t* zone, void* base, size_t size, buddy_page_t* page_map) {
+    memset(zone, 0, sizeof(buddy_zone_t));
+    zone->base = (uintptr_t)base;
+    zone->page_count = size >> BUDDY_PAGE_SHIFT;
+    zone->pages = page_map;
+    memset(page_map, 0, zone->page_count * sizeof(buddy_page_t));
+
+    // Carve the region into the largest naturally aligned blocks
+    size_t page = 0;
+    while (page < zone->page_count) {
+        int order = BUDDY_MAX_ORDER;
+        while (order > 0 &&
+               ((page & (((size_t)1 << order) - 1)) != 0 ||
+                page + ((size_t)1 << order) > zone->page_count)) {
+            order--;
+        }
+        buddy_list_push(zone, page, order);
+        page += (size_t)1 << order;
+    }
+}
+
+void* buddy_alloc(buddy_zone_t* zone, int order) {
+    if (order < 0 || order > BUDDY_MAX_ORDER) {
+        return NULL;
+    }
+
+    // Find the smallest free block that is large enough
+    int current = order;
+    while (current <= BUDDY_MAX_ORDER && !zone->free_lists[current]) {
+        current++;
+    }
+    if (current > BUDDY_MAX_ORDER) {
+        return NULL;
+    }
+
+    buddy_block_t* block = zone->free_lists[current];
+    size_t page = buddy_page_index(zone, block);
+    buddy_list_remove(zone, page, current);
+
+    // Split it down, returning the upper halves to the free lists
+    while (current > order) {
+        current--;
+        buddy_list_push(zone, page + ((size_t)1 << current), current);
+    }
+
+    zone->pages[page].order = (uint8_t)order;
+    zone->pages[page].flags = BUDDY_PAGE_HEAD;
+    return block;
+}
+
+int buddy_free(buddy_zone_t* zone, void* ptr) {
+    if (!buddy_owns(zone, ptr) || ((uintptr_t)ptr & (BUDDY_PAGE_SIZE - 1))) {
+        return 0;
+    }
+
+    size_t page = buddy_page_index(zone, ptr);
+    if (zone->pages[page].flags != BUDDY_PAGE_HEAD) {
+        return 0; // Not the start of an allocated block (or already free)
+    }
+
+    // Merge with the buddy for as long as it is free and the same size
+    int order = zone->pages[page].order;
+    zone->pages[page].flags = 0;
+    while (order < BUDDY_MAX_ORDER) {
+        size_t buddy = page ^ ((size_t)1 << order);
+        if (buddy + ((size_t)1 << order) > zone->page_count ||
+            zone->pages[buddy].flags != (BUDDY_PAGE_HEAD | BUDDY_PAGE_FREE) ||
+            zone->pages[buddy].order != order) {
+            break;
+        }
+        buddy_list_remove(zone, buddy, order);
+        if (buddy < page) {
+            page = buddy;
+        }
+        order++;
+    }
+
+    buddy_list_push(zone, page, order);
+    return 1;
+}
+
+// Change the order of an allocated block without moving it. Shrinking
+// returns the upper halves to the free lists; growing succeeds only if the
+// block is the lower half at every level and each upper buddy is free.
+int buddy_resize(buddy_zone_t* zone, void* ptr, int order) {
+    if (order < 0 || order > BUDDY_MAX_ORDER || !buddy_block_size(zone, ptr)) {
+        return 0;
+    }
+
+    size_t page = buddy_page_index(zone, ptr);
+    int current = zone->pages[page].order;
+
+    if (order > current) {
+        for (int o = current; o < order; o++) {
+            size_t buddy = page + ((size_t)1 << o);
+            if ((page & (((size_t)1 << (o + 1)) - 1)) != 0 ||
+                buddy + ((size_t)1 << o) > zone->page_count ||
+                zone->pages[buddy].flags != (BUDDY_PAGE_HEAD | BUDDY_PAGE_FREE) ||
+                zone->pages[buddy].order != o) {
+                return 0;
+            }
+        }
+        for (int o = current; o < order; o++) {
+            buddy_list_remove(zone, page + ((size_t)1 << o), o);
+        }
+    } else {
+        // The lower half stays allocated, so the freed halves cannot merge
+        while (current > order) {
+            current--;
+            buddy_list_push(zone, page + ((size_t)1 << current), current);
+        }
+    }
+
+    zone->pages[page].order = (uint8_t)order;
+    return 1;
+}
+
+int buddy_owns(const buddy_zone_t* zone, const void* ptr) {
+    uintptr_t addr = (uintptr_t)ptr;
+    return addr >= zone->base &&
+           addr < zone->base + (zone->page_count << BUDDY_PAGE_SHIFT);
+}
+
+// Size of the allocated block starting at ptr, or 0 if there is none
+size_t buddy_block_size(const buddy_zone_t* zone, const void* ptr) {
+    if (!buddy_owns(zone, ptr) || ((uintptr_t)ptr & (BUDDY_PAGE_SIZE - 1))) {
+        return 0;
+    }
+
+    size_t page = buddy_page_index(zone, ptr);
+    if (zone->pages[page].flags != BUDDY_PAGE_HEAD) {
+        return 0;
+    }
+    return (size_t)BUDDY_PAGE_SIZE << zone->pages[page].order;
+}
+
+void buddy_print_stats(const buddy_zone_t* zone) {
+    char buffer[32];
+
+    terminal_writestring("  Pages: ");
+    uint32_to_string(zone->page_count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" total, ");
+    uint32_to_string(zone->free_pages, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" free\n");
+
+    for (int order = 0; order <= BUDDY_MAX_ORDER; order++) {
+        size_t count = zone->free_blocks[order];
+        if (count == 0) {
+            continue;
+        }
+
+        terminal_writestring("  Order ");
+        uint32_to_string(order, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring(" (");
+        uint32_to_string((BUDDY_PAGE_SIZE << order) / 1024, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring("KB): ");
+        uint32_to_string(count, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring(" free\n");
+    }
+}
@@ -0,0 +1,123 @@
+#include "clock.h"
+#include "timer.h"
+#include "io.h"
+#include "terminal.h"
+#include "string.h"
+
+// PIT channel 2 is gated and read back through the keyboard controller's
+// port B
+#define PIT_CH2_PORT       0x42
+#define PIT_PORT_B         0x61
+#define PIT_PORT_B_GATE2   0x01
+#define PIT_PORT_B_SPEAKER 0x02
+#define PIT_PORT_B_OUT2    0x20
+
+// Give up on OUT2 after ten countdowns' worth of cycles at 10GHz, so a
+// timer that never fires costs a fraction of a second, not minutes of
+// port reads
+#define CLOCK_TIMEOUT_CYCLES (10000000000ULL / 1000 * CLOCK_CALIBRATE_MS * 10)
+
+static uint64_t tsc_hz = 0;
+static uint64_t tsc_boot = 0;
+static int tsc_invariant = 0;
+
+// Nanoseconds per cycle as a 32.32 fixed-point multiplier
+static uint64_t ns_mult = 0;
+
+static inline void clock_cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+uint64_t clock_cycles(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// Count TSC cycles across a one-shot PIT channel 2 countdown. The speaker
+// stays off; OUT2 goes high when the count runs out.
+static uint64_t clock_measure_tsc(void) {
+    uint16_t count = (uint16_t)(PIT_FREQ * CLOCK_CALIBRATE_MS / 1000);
+    
+    uint8_t port_b = inb(PIT_PORT_B);
+    outb(PIT_PORT_B, (port_b & ~PIT_PORT_B_SPEAKER) & ~PIT_PORT_B_GATE2);
+    
+    // Channel 2, Access lo/hi, Mode 0 (Interrupt on terminal count), Binary
+    outb(PIT_CMD_PORT, 0xB0);
+    outb(PIT_CH2_PORT, count & 0xFF);
+    outb(PIT_CH2_PORT, count >> 8);
+    
+    // Raising the gate starts the count
+    outb(PIT_PORT_B, (port_b & ~PIT_PORT_B_SPEAKER) | PIT_PORT_B_GATE2);
+    uint64_t start = clock_cycles();
+    uint64_t end = start;
+    while (1) {
+        int expired = inb(PIT_PORT_B) & PIT_PORT_B_OUT2;
+        uint64_t now = clock_cycles();
+        if (expired) {
+            end = now;
+            break;
+        }
+        if (now - start > CLOCK_TIMEOUT_CYCLES) {
+            break; // OUT2 never rose: report failure
+        }
+    }
+    
+    outb(PIT_PORT_B, port_b);
+    return end - start;
+}
+
+void clock_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    clock_cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000007) {
+        clock_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        tsc_invariant = (edx >> 8) & 1;
+    }
+    
+    // Best of a few runs: an SMI or emulator hiccup only ever adds cycles
+    // to the poll loop's exit, so the shortest run is the most accurate
+    uint64_t best = 0;
+    for (int run = 0; run < 3; run++) {
+        uint64_t cycles = clock_measure_tsc();
+        if (cycles && (best == 0 || cycles < best)) {
+            best = cycles;
+        }
+    }
+    if (!best) {
+        terminal_writestring("WARNING: TSC calibration failed, clock_ns falls back to the tick\n");
+        return;
+    }
+    
+    tsc_hz = best * 1000 / CLOCK_CALIBRATE_MS;
+    ns_mult = (1000000000ULL << 32) / tsc_hz;
+    tsc_boot = clock_cycles();
+    
+    char buffer[16];
+    terminal_writestring("TSC: ");
+    uint32_to_string((uint32_t)(tsc_hz / 1000000), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(tsc_invariant ? " MHz, invariant\n"
+                                       : " MHz, not invariant (may drift with CPU frequency)\n");
+}
+
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+    return (uint64_t)(((unsigned __int128)cycles * ns_mult) >> 32);
+}
+
+// Nanoseconds since clock_init, at tick resolution if the TSC could not
+// be calibrated
+uint64_t clock_ns(void) {
+    if (!tsc_hz) {
+        return timer_ms() * 1000000;
+    }
+    return clock_cycles_to_ns(clock_cycles() - tsc_boot);
+}
+
+uint64_t clock_tsc_hz(void) {
+    return tsc_hz;
+}
+
+int clock_tsc_invariant(void) {
+    return tsc_invariant;
+}
@@ -2,6 +2,8 @@
 #include "terminal.h"
 #include "string.h"
 #include "memory.h"
+#include "slab.h"
+#include "memory_utils.h"
 #include "fat16.h"
 
 #define MAX_COMMANDS 64
@@ -11,6 +13,9 @@
 static const command_info_t* command_registry[MAX_COMMANDS];
 static size_t command_count = 0;
 
+// Slab cache for parsed command lines
+static kmem_cache_t* command_args_cache = NULL;
+
 // Register a command in the registry
 command_result_t command_register(const command_info_t* info) {
     if (!info || !info->name || !info->main) {
@@ -113,77 +118,89 @@ int command_parse_args(const char* input, char*** argv_out) {
         return 0;
     }
     
-    // Count arguments
-    int argc = 0;
-    const char* p = input;
-    int in_word = 0;
+    *argv_out = NULL;
     
-    while (*p) {
-        if (*p != ' ' && *p != '\t') {
-            if (!in_word) {
-                argc++;
-                in_word = 1;
-            }
-        } else {
-            in_word = 0;
-        }
-        p++;
+    // Words plus their terminators never need more than the line itself
+    if (strlen(input) >= COMMAND_MAX_LINE) {
+        terminal_writestring("Command line too long\n");
+        return 0;
     }
     
-    if (argc == 0) {
-        *argv_out = NULL;
-        return 0;
+    if (!command_args_cache) {
+        command_args_cache = kmem_cache_create("command_args", sizeof(command_args_t), 0, NULL);
     }
     
-    // Allocate argv array
-    char** argv = (char**)kmalloc((argc + 1) * sizeof(char*));
-    if (!argv) {
-        *argv_out = NULL;
+    command_args_t* args = (command_args_t*)kmem_cache_alloc(command_args_cache);
+    if (!args) {
         return 0;
     }
     
-    // Parse arguments
-    int arg_index = 0;
-    p = input;
-    in_word = 0;
-    const char* word_start = NULL;
+    // Split the line into words, copying each into the shared string buffer
+    int argc = 0;
+    char* out = args->strings;
+    const char* p = input;
     
-    while (*p || in_word) {
-        if ((*p != ' ' && *p != '\t' && *p != '\0') && !in_word) {
-            // Start of new word
-            word_start = p;
-            in_word = 1;
-        } else if ((*p == ' ' || *p == '\t' || *p == '\0') && in_word) {
-            // End of word
-            size_t word_len = p - word_start;
-            argv[arg_index] = (char*)kmalloc(word_len + 1);
-            if (argv[arg_index]) {
-                strncpy(argv[arg_index], word_start, word_len);
-                argv[arg_index][word_len] = '\0';
-                arg_index++;
-            }
-            in_word = 0;
+    while (*p && argc < COMMAND_MAX_ARGS) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
         }
         
-        if (*p == '\0') break;
-        p++;
+        args->argv[argc++] = out;
+        while (*p && *p != ' ' && *p != '\t') {
+            *out++ = *p++;
+        }
+        *out++ = '\0';
     }
     
-    argv[arg_index] = NULL;
-    *argv_out = argv;
+    if (argc == 0) {
+        kmem_cache_free(command_args_cache, args);
+        return 0;
+    }
+    
+    args->argv[argc] = NULL;
+    *argv_out = args->argv;
     return argc;
 }
 
 // Free parsed arguments
 void command_free_args(int argc, char** argv) {
+    (void)argc;
     if (!argv) return;
     
-    for (int i = 0; i < argc; i++) {
-        if (argv[i]) {
-            kfree(argv[i]);
+    // argv is the first member of its command_args_t
+    kmem_cache_free(command_args_cache, (command_args_t*)argv);
+}
+
+// Join argv[first..argc-1] with single spaces into a heap string that the
+// caller releases with kfree. The buffer grows with krealloc, which extends
+// it in place while the heap allows.
+char* command_join_args(int argc, char** argv, int first) {
+    char* joined = NULL;
+    size_t length = 0;
+    
+    for (int i = first; i < argc; i++) {
+        size_t arg_length = strlen(argv[i]);
+        size_t separator = (i > first) ? 1 : 0;
+        
+        char* grown = (char*)krealloc(joined, length + separator + arg_length + 1);
+        if (!grown) {
+            kfree(joined);
+            return NULL;
         }
+        joined = grown;
+        
+        if (separator) {
+            joined[length++] = ' ';
+        }
+        memcpy(joined + length, argv[i], arg_length);
+        length += arg_length;
+        joined[length] = '\0';
     }
-    kfree(argv);
+    
+    return joined;
 }
 
 // Check if --help flag is present in arguments
@@ -210,12 +227,16 @@ extern const command_info_t cmd_info_cmd_help_main;
 extern const command_info_t cmd_info_cmd_clear_main;
 extern const command_info_t cmd_info_cmd_meminfo_main;
 extern const command_info_t cmd_info_cmd_memtest_main;
+extern const command_info_t cmd_info_cmd_slabinfo_main;
+extern const command_info_t cmd_info_cmd_heapstat_main;
+extern const command_info_t cmd_info_cmd_memtrace_main;
 extern const command_info_t cmd_info_cmd_ls_main;
 extern const command_info_t cmd_info_cmd_cat_main;
 extern const command_info_t cmd_info_cmd_create_main;
 extern const command_info_t cmd_info_cmd_ps_main;
 extern const command_info_t cmd_info_cmd_kill_main;
 extern const command_info_t cmd_info_cmd_spawn_main;
+extern const command_info_t cmd_info_cmd_shm_main;
 extern const command_info_t cmd_info_cmd_shutdown_main;
 extern const command_info_t cmd_info_cmd_reboot_main;
 extern const command_info_t cmd_info_cmd_ramdisk_main;
@@ -225,7 +246,10 @@ extern const command_info_t cmd_info_cmd_pwd_main;
 extern const command_info_t cmd_info_cmd_gfx_main;
 extern const command_info_t cmd_info_cmd_draw_main;
 extern const command_info_t cmd_info_cmd_fontdemo_main;
+extern const command_info_t cmd_info_cmd_fbbench_main;
 extern const command_info_t cmd_info_cmd_lsdisks_main;
+extern const command_info_t cmd_info_cmd_swapon_main;
+extern const command_info_t cmd_info_cmd_timerbench_main;
 extern const command_info_t cmd_info_cmd_date_main;
 extern const command_info_t cmd_info_cmd_platformer_main;
 extern const command_info_t cmd_info_cmd_doom_main;
@@ -236,12 +260,16 @@ void command_register_builtins(void) {
     command_register(&cmd_info_cmd_clear_main);
     command_register(&cmd_info_cmd_meminfo_main);
     command_register(&cmd_info_cmd_memtest_main);
+    command_register(&cmd_info_cmd_slabinfo_main);
+    command_register(&cmd_info_cmd_heapstat_main);
+    command_register(&cmd_info_cmd_memtrace_main);
     command_register(&cmd_info_cmd_ls_main);
     command_register(&cmd_info_cmd_cat_main);
     command_register(&cmd_info_cmd_create_main);
     command_register(&cmd_info_cmd_ps_main);
     command_register(&cmd_info_cmd_kill_main);
     command_register(&cmd_info_cmd_spawn_main);
+    command_register(&cmd_info_cmd_shm_main);
     command_register(&cmd_info_cmd_shutdown_main);
     command_register(&cmd_info_cmd_reboot_main);
     command_register(&cmd_info_cmd_ramdisk_main);
@@ -254,5 +282,8 @@ void command_register_builtins(void) {
     command_register(&cmd_info_cmd_gfx_main);
     command_register(&cmd_info_cmd_draw_main);
     command_register(&cmd_info_cmd_fontdemo_main);
+    command_register(&cmd_info_cmd_fbbench_main);
     command_register(&cmd_info_cmd_lsdisks_main);
+    command_register(&cmd_info_cmd_swapon_main);
+    command_register(&cmd_info_cmd_timerbench_main);
 }
@@ -0,0 +1,528 @@
+#include "frame.h"
+#include "kernel.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+#include "vmm.h"
+#include "process.h"
+#include "swap.h"
+
+// One bit per 4KB frame; a set bit means allocated, reserved or absent.
+// Everything starts out set and only RAM the memory map reports as
+// available is cleared.
+static uint64_t frame_bitmap[FRAME_MAX_COUNT / 64];
+static size_t frame_limit = 0;        // One past the highest usable frame
+static size_t frames_total = 0;       // Usable frames in the memory map
+static size_t frames_free = 0;        // Free frames, cached ones included
+static size_t search_hint = 0;        // Bitmap word where the last refill stopped
+
+// Free-list cache of 4KB frame numbers. Cached frames stay set in the
+// bitmap so single-frame allocation and free are O(1) most of the time.
+static uint64_t frame_cache[FRAME_CACHE_SIZE];
+static int frame_cache_count = 0;
+
+// Frame numbers already filled with zeros. Like cached frames they stay
+// set in the bitmap but count as free.
+static uint64_t zero_pool[FRAME_ZERO_POOL_SIZE];
+static int zero_pool_count = 0;
+static size_t zero_hits = 0;          // frame_alloc_zeroed served from the pool
+static size_t zero_misses = 0;        // ...and cleared on the spot
+
+// One bit per frame sitting in the cache or the zeroed pool, so frame_free
+// can reject a double free without searching either
+static uint64_t frame_parked[FRAME_MAX_COUNT / 64];
+
+// Reference counts for shared frames, open addressed by frame number.
+// A frame missing from the table has exactly one owner; frame 0 is never
+// allocated, so it marks an empty slot.
+typedef struct {
+    uint32_t frame;
+    uint32_t count;
+} frame_share_t;
+
+static frame_share_t frame_shares[FRAME_SHARED_MAX];
+static size_t frames_shared = 0;
+
+static inline int frame_test(size_t frame) {
+    return (frame_bitmap[frame / 64] >> (frame % 64)) & 1;
+}
+
+static inline void frame_set(size_t frame) {
+    frame_bitmap[frame / 64] |= 1ULL << (frame % 64);
+}
+
+static inline void frame_clear(size_t frame) {
+    frame_bitmap[frame / 64] &= ~(1ULL << (frame % 64));
+}
+
+static inline int frame_is_parked(size_t frame) {
+    return (frame_parked[frame / 64] >> (frame % 64)) & 1;
+}
+
+static inline void frame_cache_push(size_t frame) {
+    frame_parked[frame / 64] |= 1ULL << (frame % 64);
+    frame_cache[frame_cache_count++] = frame;
+}
+
+static inline size_t frame_cache_pop(void) {
+    size_t frame = frame_cache[--frame_cache_count];
+    frame_parked[frame / 64] &= ~(1ULL << (frame % 64));
+    return frame;
+}
+
+static inline void frame_zero_pool_push(size_t frame) {
+    frame_parked[frame / 64] |= 1ULL << (frame % 64);
+    zero_pool[zero_pool_count++] = frame;
+}
+
+static inline size_t frame_zero_pool_pop(void) {
+    size_t frame = zero_pool[--zero_pool_count];
+    frame_parked[frame / 64] &= ~(1ULL << (frame % 64));
+    return frame;
+}
+
+// Mark the whole frames inside [start, end) as usable RAM
+static void frame_add_range(uint64_t start, uint64_t end) {
+    if (end > FRAME_MAX_MEMORY) {
+        end = FRAME_MAX_MEMORY;
+    }
+    size_t first = (start + FRAME_SIZE - 1) >> FRAME_SHIFT;
+    size_t last = end >> FRAME_SHIFT;
+
+    for (size_t frame = first; frame < last; frame++) {
+        if (frame_test(frame)) {
+            frame_clear(frame);
+            frames_total++;
+            frames_free++;
+        }
+    }
+    if (last > frame_limit) {
+        frame_limit = last;
+    }
+}
+
+// Take every frame touching [start, end) out of the free pool
+static void frame_reserve_range(uint64_t start, uint64_t end) {
+    if (end > FRAME_MAX_MEMORY) {
+        end = FRAME_MAX_MEMORY;
+    }
+    size_t first = start >> FRAME_SHIFT;
+    size_t last = (end + FRAME_SIZE - 1) >> FRAME_SHIFT;
+
+    for (size_t frame = first; frame < last; frame++) {
+        if (!frame_test(frame)) {
+            frame_set(frame);
+            frames_free--;
+        }
+    }
+}
+
+void frame_init(uint32_t multiboot_magic, uint32_t multiboot_info) {
+    memset(frame_bitmap, 0xFF, sizeof(frame_bitmap));
+    memset(frame_parked, 0, sizeof(frame_parked));
+    frame_limit = 0;
+    frames_total = 0;
+    frames_free = 0;
+    frame_cache_count = 0;
+
+    if (multiboot_magic != MULTIBOOT_BOOTLOADER_MAGIC || multiboot_info == 0) {
+        terminal_writestring("WARNING: No multiboot information, physical memory unavailable\n");
+        return;
+    }
+
+    multiboot_info_t* mbi = (multiboot_info_t*)(uintptr_t)multiboot_info;
+
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uintptr_t entry_addr = mbi->mmap_addr;
+        uintptr_t mmap_end = mbi->mmap_addr + mbi->mmap_length;
+        while (entry_addr < mmap_end) {
+            multiboot_mmap_entry_t* entry = (multiboot_mmap_entry_t*)entry_addr;
+            if (entry->type == MULTIBOOT_MEMORY_AVAILABLE) {
+                frame_add_range(entry->addr, entry->addr + entry->len);
+            }
+            entry_addr += entry->size + sizeof(entry->size);
+        }
+    } else if (mbi->flags & MULTIBOOT_INFO_MEMORY) {
+        // No map - fall back to the contiguous upper memory size
+        frame_add_range(0x100000, 0x100000 + (uint64_t)mbi->mem_upper * 1024);
+    }
+
+    // Low memory (BIOS data, VGA memory, option ROMs) and the kernel image,
+    // whose .bss holds the boot page tables, boot stack and static heap pool
+    frame_reserve_range(0, 0x100000);
+    frame_reserve_range((uintptr_t)kernel_start, (uintptr_t)kernel_end);
+
+    // The boot information itself and everything it points at
+    frame_reserve_range(multiboot_info, multiboot_info + sizeof(multiboot_info_t));
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        frame_reserve_range(mbi->mmap_addr, (uint64_t)mbi->mmap_addr + mbi->mmap_length);
+    }
+    if (mbi->flags & MULTIBOOT_INFO_CMDLINE) {
+        const char* cmdline = (const char*)(uintptr_t)mbi->cmdline;
+        frame_reserve_range(mbi->cmdline, (uint64_t)mbi->cmdline + strlen(cmdline) + 1);
+    }
+    if (mbi->flags & MULTIBOOT_INFO_MODS) {
+        multiboot_module_t* mods = (multiboot_module_t*)(uintptr_t)mbi->mods_addr;
+        frame_reserve_range(mbi->mods_addr, (uint64_t)mbi->mods_addr + mbi->mods_count * sizeof(multiboot_module_t));
+        for (uint32_t i = 0; i < mbi->mods_count; i++) {
+            frame_reserve_range(mods[i].mod_start, mods[i].mod_end);
+            if (mods[i].string) {
+                const char* name = (const char*)(uintptr_t)mods[i].string;
+                frame_reserve_range(mods[i].string, (uint64_t)mods[i].string + strlen(name) + 1);
+            }
+        }
+    }
+
+    terminal_writestring("Physical memory: ");
+    char buffer[32];
+    uint32_to_string((uint32_t)((frames_total * FRAME_SIZE) / (1024 * 1024)), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring("MB usable, ");
+    uint32_to_string((uint32_t)((frames_free * FRAME_SIZE) / (1024 * 1024)), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring("MB free\n");
+}
+
+// Move a batch of free frames from the bitmap into the cache
+static void frame_cache_refill(void) {
+    size_t words = (frame_limit + 63) / 64;
+    if (words == 0) {
+        return;
+    }
+
+    for (size_t scanned = 0; scanned < words && frame_cache_count < FRAME_CACHE_SIZE / 2; scanned++) {
+        size_t word = (search_hint + scanned) % words;
+        while (~frame_bitmap[word] && frame_cache_count < FRAME_CACHE_SIZE / 2) {
+            size_t frame = word * 64 + __builtin_ctzll(~frame_bitmap[word]);
+            if (frame >= frame_limit) {
+                break;
+            }
+            frame_set(frame);
+            frame_cache_push(frame);
+        }
+        search_hint = word;
+    }
+}
+
+// Give every cached frame back to the bitmap so large runs can form
+static void frame_cache_drain(void) {
+    while (frame_cache_count > 0) {
+        frame_clear(frame_cache_pop());
+    }
+}
+
+static void frame_zero_pool_drain(void) {
+    while (zero_pool_count > 0) {
+        frame_clear(frame_zero_pool_pop());
+    }
+}
+
+// A frame from the cache or the bitmap only. Never dips into the zeroed
+// pool or reclaims process memory.
+static uint64_t frame_alloc_free(void) {
+    if (frame_cache_count == 0) {
+        frame_cache_refill();
+        if (frame_cache_count == 0) {
+            return 0;
+        }
+    }
+
+    frames_free--;
+    return (uint64_t)frame_cache_pop() << FRAME_SHIFT;
+}
+
+uint64_t frame_alloc(void) {
+    uint64_t addr = frame_alloc_free();
+    if (addr) {
+        return addr;
+    }
+
+    // Zeroed frames are a last resort for callers that do not need them
+    if (zero_pool_count > 0) {
+        frames_free--;
+        return (uint64_t)frame_zero_pool_pop() << FRAME_SHIFT;
+    }
+    // Out of memory: push cold process pages out to swap
+    if (process_swap_out(SWAP_EVICT_BATCH)) {
+        return frame_alloc();
+    }
+    return 0;
+}
+
+// Clear a frame through the identity map. The idle loop uses non-temporal
+// stores so zeroing pages nobody is about to touch does not evict the
+// cache; on the allocation path the caller is about to use the page, so
+// plain stores leave it cached.
+static void frame_zero(uint64_t addr, int non_temporal) {
+    uint64_t* page = (uint64_t*)(uintptr_t)addr;
+    if (non_temporal) {
+        for (size_t i = 0; i < FRAME_SIZE / sizeof(uint64_t); i++) {
+            __asm__ volatile("movnti %1, %0" : "=m"(page[i]) : "r"(0ULL));
+        }
+        __asm__ volatile("sfence" : : : "memory");
+    } else {
+        size_t count = FRAME_SIZE / sizeof(uint64_t);
+        __asm__ volatile("rep stosq" : "+D"(page), "+c"(count) : "a"(0ULL) : "memory");
+    }
+}
+
+// A frame filled with zeros, from the pool when the idle loop has kept up.
+// Only frames inside the identity map can be cleared here.
+uint64_t frame_alloc_zeroed(void) {
+    if (zero_pool_count > 0) {
+        zero_hits++;
+        frames_free--;
+        return (uint64_t)frame_zero_pool_pop() << FRAME_SHIFT;
+    }
+
+    uint64_t addr = frame_alloc();
+    if (!addr) {
+        return 0;
+    }
+    if (addr + FRAME_SIZE > vmm_identity_limit()) {
+        frame_free(addr);
+        return 0;
+    }
+    zero_misses++;
+    frame_zero(addr, 0);
+    return addr;
+}
+
+// Zero up to max_frames free frames into the pool. Called when there is
+// nothing else to run; returns the number of frames cleared. Only truly
+// free frames are used, so a nearly full machine lets the idle loop halt.
+size_t frame_zero_idle(size_t max_frames) {
+    size_t done = 0;
+    while (done < max_frames && zero_pool_count < FRAME_ZERO_POOL_SIZE) {
+        uint64_t addr = frame_alloc_free();
+        if (!addr) {
+            break;
+        }
+        if (addr + FRAME_SIZE > vmm_identity_limit()) {
+            frame_free(addr);
+            break;
+        }
+        frame_zero(addr, 1);
+        frame_zero_pool_push(addr >> FRAME_SHIFT);
+        frames_free++;
+        done++;
+    }
+    return done;
+}
+
+static size_t frame_share_slot(size_t frame) {
+    return ((uint32_t)frame * 2654435761u) & (FRAME_SHARED_MAX - 1);
+}
+
+// Table slot holding frame, or -1
+static int frame_share_find(size_t frame) {
+    size_t slot = frame_share_slot(frame);
+    while (frame_shares[slot].frame) {
+        if (frame_shares[slot].frame == frame) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & (FRAME_SHARED_MAX - 1);
+    }
+    return -1;
+}
+
+// Remove a slot, shifting later entries of its probe run back so lookups
+// never need tombstones
+static void frame_share_remove(size_t slot) {
+    size_t next = (slot + 1) & (FRAME_SHARED_MAX - 1);
+    while (frame_shares[next].frame) {
+        size_t home = frame_share_slot(frame_shares[next].frame);
+        if (((next - home) & (FRAME_SHARED_MAX - 1)) >= ((next - slot) & (FRAME_SHARED_MAX - 1))) {
+            frame_shares[slot] = frame_shares[next];
+            slot = next;
+        }
+        next = (next + 1) & (FRAME_SHARED_MAX - 1);
+    }
+    frame_shares[slot].frame = 0;
+    frame_shares[slot].count = 0;
+    frames_shared--;
+}
+
+int frame_share(uint64_t addr) {
+    size_t frame = addr >> FRAME_SHIFT;
+    if ((addr & (FRAME_SIZE - 1)) || frame == 0 || frame >= frame_limit || !frame_test(frame)) {
+        return 0;
+    }
+
+    int slot = frame_share_find(frame);
+    if (slot >= 0) {
+        frame_shares[slot].count++;
+        return 1;
+    }
+
+    // Keep the table at most three quarters full so probe runs stay short
+    if (frames_shared >= FRAME_SHARED_MAX / 4 * 3) {
+        return 0;
+    }
+    size_t free_slot = frame_share_slot(frame);
+    while (frame_shares[free_slot].frame) {
+        free_slot = (free_slot + 1) & (FRAME_SHARED_MAX - 1);
+    }
+    frame_shares[free_slot].frame = (uint32_t)frame;
+    frame_shares[free_slot].count = 2;
+    frames_shared++;
+    return 1;
+}
+
+uint32_t frame_ref_count(uint64_t addr) {
+    int slot = frame_share_find(addr >> FRAME_SHIFT);
+    return slot >= 0 ? frame_shares[slot].count : 1;
+}
+
+void frame_free(uint64_t addr) {
+    size_t frame = addr >> FRAME_SHIFT;
+    if ((addr & (FRAME_SIZE - 1)) || frame == 0 || frame >= frame_limit || !frame_test(frame)) {
+        terminal_writestring("WARNING: frame_free of a frame that is not allocated\n");
+        return;
+    }
+
+    // A shared frame only loses one of its references
+    int slot = frame_share_find(frame);
+    if (slot >= 0) {
+        if (--frame_shares[slot].count <= 1) {
+            frame_share_remove(slot);
+        }
+        return;
+    }
+    // Cached and pooled frames are still set in the bitmap
+    if (frame_is_parked(frame)) {
+        terminal_writestring("WARNING: frame_free of a frame that is not allocated\n");
+        return;
+    }
+
+    if (frame_cache_count < FRAME_CACHE_SIZE) {
+        frame_cache_push(frame);
+    } else {
+        frame_clear(frame);
+    }
+    frames_free++;
+}
+
+// First run of large_count free, 2MB-aligned 2MB frames ending below limit.
+// A 2MB frame is free when its eight bitmap words are all clear.
+static uint64_t frame_find_large_run(size_t large_count, uint64_t limit) {
+    size_t groups = frame_limit / FRAMES_PER_LARGE;
+    if (limit < FRAME_MAX_MEMORY && groups > (limit >> FRAME_LARGE_SHIFT)) {
+        groups = limit >> FRAME_LARGE_SHIFT;
+    }
+
+    size_t run = 0;
+    for (size_t group = 0; group < groups; group++) {
+        uint64_t used = 0;
+        for (int word = 0; word < FRAMES_PER_LARGE / 64; word++) {
+            used |= frame_bitmap[group * (FRAMES_PER_LARGE / 64) + word];
+        }
+
+        run = used ? 0 : run + 1;
+        if (run == large_count) {
+            size_t first = group + 1 - large_count;
+            memset(&frame_bitmap[first * (FRAMES_PER_LARGE / 64)], 0xFF,
+                   large_count * (FRAMES_PER_LARGE / 8));
+            frames_free -= large_count * FRAMES_PER_LARGE;
+            return (uint64_t)first << FRAME_LARGE_SHIFT;
+        }
+    }
+    return 0;
+}
+
+uint64_t frame_alloc_contiguous(size_t large_count, uint64_t limit) {
+    if (large_count == 0) {
+        return 0;
+    }
+
+    uint64_t addr = frame_find_large_run(large_count, limit);
+    if (!addr && (frame_cache_count > 0 || zero_pool_count > 0)) {
+        // Cached and pooled single frames may be what splits a run
+        frame_cache_drain();
+        frame_zero_pool_drain();
+        addr = frame_find_large_run(large_count, limit);
+    }
+    return addr;
+}
+
+void frame_free_contiguous(uint64_t addr, size_t large_count) {
+    size_t first = addr >> FRAME_SHIFT;
+    size_t count = large_count * FRAMES_PER_LARGE;
+    if ((addr & (FRAME_LARGE_SIZE - 1)) || first == 0 || first + count > frame_limit) {
+        terminal_writestring("WARNING: frame_free of a frame that is not allocated\n");
+        return;
+    }
+
+    for (size_t frame = first; frame < first + count; frame++) {
+        if (frame_test(frame)) {
+            frame_clear(frame);
+            frames_free++;
+        }
+    }
+}
+
+uint64_t frame_alloc_large(void) {
+    return frame_alloc_contiguous(1, FRAME_MAX_MEMORY);
+}
+
+void frame_free_large(uint64_t addr) {
+    frame_free_contiguous(addr, 1);
+}
+
+size_t frame_total_count(void) {
+    return frames_total;
+}
+
+size_t frame_free_count(void) {
+    return frames_free;
+}
+
+uint64_t frame_memory_top(void) {
+    return (uint64_t)frame_limit << FRAME_SHIFT;
+}
+
+size_t frame_shared_count(void) {
+    return frames_shared;
+}
+
+void frame_print_stats(void) {
+    char buffer[32];
+
+    terminal_writestring("\nPHYSICAL MEMORY:\n");
+    terminal_writestring("  Usable: ");
+    uint32_to_string((uint32_t)(frames_total * (FRAME_SIZE / 1024)), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" KB (");
+    uint32_to_string((uint32_t)frames_total, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" frames)\n");
+
+    terminal_writestring("  Free: ");
+    uint32_to_string((uint32_t)(frames_free * (FRAME_SIZE / 1024)), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" KB (");
+    uint32_to_string((uint32_t)frame_cache_count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" frames cached)\n");
+
+    terminal_writestring("  Zeroed pool: ");
+    uint32_to_string((uint32_t)zero_pool_count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" frames (");
+    uint32_to_string((uint32_t)zero_hits, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" hits, ");
+    uint32_to_string((uint32_t)zero_misses, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" cleared on demand)\n");
+
+    terminal_writestring("  Shared: ");
+    uint32_to_string((uint32_t)frames_shared, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" frames (copy-on-write)\n");
+
+    terminal_writestring("  Top of memory: 0x");
+    uint32_to_hex((uint32_t)frame_memory_top(), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring("\n");
+}
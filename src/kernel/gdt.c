@@ -0,0 +1,37 @@
+#include "gdt.h"
+#include "memory_utils.h"
+
+// Null, kernel code, kernel data and a 16-byte TSS descriptor
+static uint64_t gdt[5];
+static tss_t tss;
+static uint8_t ist_stacks[3][IST_STACK_SIZE] __attribute__((aligned(16)));
+
+typedef struct __attribute__((packed)) {
+    uint16_t limit;
+    uint64_t base;
+} gdt_pointer_t;
+
+void gdt_init(void) {
+    gdt[0] = 0;
+    gdt[1] = (1ULL << 43) | (1ULL << 44) | (1ULL << 47) | (1ULL << 53); // Code: executable, present, long mode
+    gdt[2] = (1ULL << 41) | (1ULL << 44) | (1ULL << 47);                // Data: writable, present
+
+    memset(&tss, 0, sizeof(tss));
+    tss.ist[IST_PAGE_FAULT - 1] = (uint64_t)(uintptr_t)&ist_stacks[0][IST_STACK_SIZE];
+    tss.ist[IST_DOUBLE_FAULT - 1] = (uint64_t)(uintptr_t)&ist_stacks[1][IST_STACK_SIZE];
+    tss.ist[IST_IRQ - 1] = (uint64_t)(uintptr_t)&ist_stacks[2][IST_STACK_SIZE];
+    tss.iomap_base = sizeof(tss);
+
+    // Available 64-bit TSS descriptor, split across two GDT slots
+    uint64_t base = (uint64_t)(uintptr_t)&tss;
+    uint64_t limit = sizeof(tss) - 1;
+    gdt[3] = (limit & 0xFFFF) | ((base & 0xFFFFFF) << 16) | (0x9ULL << 40) | (1ULL << 47) |
+             (((limit >> 16) & 0xF) << 48) | (((base >> 24) & 0xFF) << 56);
+    gdt[4] = base >> 32;
+
+    gdt_pointer_t pointer;
+    pointer.limit = sizeof(gdt) - 1;
+    pointer.base = (uint64_t)(uintptr_t)gdt;
+    __asm__ volatile("lgdt %0" : : "m"(pointer));
+    __asm__ volatile("ltr %w0" : : "r"((uint16_t)GDT_TSS));
+}
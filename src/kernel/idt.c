@@ -0,0 +1,149 @@
+#include "idt.h"
+#include "gdt.h"
+#include "terminal.h"
+#include "process.h"
+#include "string.h"
+#include "memory_utils.h"
+#include "pic.h"
+
+// Interrupt gate descriptor
+typedef struct __attribute__((packed)) {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t ist;                     // Interrupt stack table slot, 0 = current stack
+    uint8_t type_attr;
+    uint16_t offset_mid;
+    uint32_t offset_high;
+    uint32_t reserved;
+} idt_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t limit;
+    uint64_t base;
+} idt_pointer_t;
+
+#define IDT_INTERRUPT_GATE 0x8E      // Present, ring 0, 64-bit interrupt gate
+
+static idt_entry_t idt[IDT_ENTRIES] __attribute__((aligned(16)));
+static interrupt_handler_t handlers[IDT_ENTRIES];
+
+// Entry stubs from boot.asm
+extern uint64_t isr_stub_table[];
+
+static const char* exception_names[IDT_EXCEPTIONS] = {
+    "Divide error", "Debug", "NMI", "Breakpoint", "Overflow", "Bound range exceeded",
+    "Invalid opcode", "Device not available", "Double fault", "Coprocessor segment overrun",
+    "Invalid TSS", "Segment not present", "Stack-segment fault", "General protection fault",
+    "Page fault", "Reserved", "x87 floating-point exception", "Alignment check",
+    "Machine check", "SIMD floating-point exception", "Virtualization exception",
+    "Control protection exception", "Reserved", "Reserved", "Reserved", "Reserved",
+    "Reserved", "Reserved", "Hypervisor injection exception", "VMM communication exception",
+    "Security exception", "Reserved"
+};
+
+static void idt_set_gate(int vector, uint64_t handler, uint8_t ist) {
+    idt[vector].offset_low = handler & 0xFFFF;
+    idt[vector].selector = GDT_KERNEL_CODE;
+    idt[vector].ist = ist;
+    idt[vector].type_attr = IDT_INTERRUPT_GATE;
+    idt[vector].offset_mid = (handler >> 16) & 0xFFFF;
+    idt[vector].offset_high = (uint32_t)(handler >> 32);
+    idt[vector].reserved = 0;
+}
+
+void idt_init(void) {
+    memset(idt, 0, sizeof(idt));
+
+    for (int vector = 0; vector < IDT_EXCEPTIONS; vector++) {
+        idt_set_gate(vector, isr_stub_table[vector], 0);
+    }
+
+    // A stack overflow faults on the guard page with no usable stack left
+    idt[IDT_VECTOR_PAGE_FAULT].ist = IST_PAGE_FAULT;
+    idt[IDT_VECTOR_DOUBLE_FAULT].ist = IST_DOUBLE_FAULT;
+
+    // IRQs can arrive with a process stack about to grow into a page that
+    // is not faulted in yet, so they never push onto the interrupted stack
+    for (int vector = IDT_EXCEPTIONS; vector < IDT_STUBS; vector++) {
+        idt_set_gate(vector, isr_stub_table[vector], IST_IRQ);
+    }
+
+    idt_pointer_t pointer;
+    pointer.limit = sizeof(idt) - 1;
+    pointer.base = (uint64_t)(uintptr_t)idt;
+    __asm__ volatile("lidt %0" : : "m"(pointer));
+}
+
+void idt_register_handler(uint8_t vector, interrupt_handler_t handler) {
+    handlers[vector] = handler;
+}
+
+// Called from isr_common in boot.asm
+void interrupt_dispatch(interrupt_frame_t* frame) {
+    if (frame->vector >= PIC_IRQ_BASE && frame->vector < PIC_IRQ_BASE + PIC_IRQ_COUNT) {
+        uint8_t irq = frame->vector - PIC_IRQ_BASE;
+        if (pic_is_spurious(irq)) {
+            return;
+        }
+        if (handlers[frame->vector]) {
+            handlers[frame->vector](frame);
+        }
+        pic_send_eoi(irq);
+        return;
+    }
+
+    if (handlers[frame->vector]) {
+        handlers[frame->vector](frame);
+        return;
+    }
+
+    idt_panic(frame, frame->vector < IDT_EXCEPTIONS ? exception_names[frame->vector]
+                                                    : "Unexpected interrupt");
+}
+
+static void idt_write_hex64(const char* label, uint64_t value) {
+    char buffer[16];
+    terminal_writestring(label);
+    terminal_writestring("0x");
+    if (value >> 32) {
+        uint32_to_hex((uint32_t)(value >> 32), buffer);
+        terminal_writestring(buffer);
+        uint32_to_hex((uint32_t)value, buffer);
+        for (int pad = strlen(buffer); pad < 8; pad++) {
+            terminal_writestring("0");
+        }
+    } else {
+        uint32_to_hex((uint32_t)value, buffer);
+    }
+    terminal_writestring(buffer);
+}
+
+void idt_panic(interrupt_frame_t* frame, const char* message) {
+    terminal_setcolor(make_vga_color(VGA_COLOR_WHITE, VGA_COLOR_RED));
+    terminal_writestring("\nKERNEL PANIC: ");
+    terminal_writestring(message);
+    terminal_writestring("\n");
+
+    idt_write_hex64("  RIP: ", frame->rip);
+    idt_write_hex64("  RSP: ", frame->rsp);
+    idt_write_hex64("  Error: ", frame->error_code);
+    terminal_writestring("\n");
+
+    if (frame->vector == IDT_VECTOR_PAGE_FAULT) {
+        uint64_t address;
+        __asm__ volatile("mov %%cr2, %0" : "=r"(address));
+        idt_write_hex64("  Fault address: ", address);
+        terminal_writestring("\n");
+    }
+
+    if (current_process) {
+        terminal_writestring("  Process: ");
+        terminal_writestring(current_process->name);
+        terminal_writestring("\n");
+    }
+
+    terminal_writestring("System halted.\n");
+    while (1) {
+        __asm__ volatile("cli; hlt");
+    }
+}
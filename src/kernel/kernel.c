@@ -8,9 +8,39 @@
 #include "memory.h"
 #include "vga.h"
 #include "ata.h"
+#include "frame.h"
+#include "vmm.h"
+#include "gdt.h"
+#include "idt.h"
+#include "pic.h"
+#include "timer.h"
+#include "clock.h"
 
-// Main kernel function - called from assembly
-void kernel_main(void) {
+// Give the heap a share of physical memory: half of what is free, capped
+// at MEMORY_REGION_MAX_SIZE, and inside the identity map so the kernel can
+// address it directly
+static void kernel_add_heap_region(void) {
+    size_t large_count = frame_free_count() / 2 / FRAMES_PER_LARGE;
+    if (large_count > MEMORY_REGION_MAX_SIZE / FRAME_LARGE_SIZE) {
+        large_count = MEMORY_REGION_MAX_SIZE / FRAME_LARGE_SIZE;
+    }
+    
+    // Memory above the identity map counts as free too, so settle for a
+    // smaller region if that much is not available below it
+    while (large_count > 0) {
+        uint64_t base = frame_alloc_contiguous(large_count, vmm_identity_limit());
+        if (base) {
+            if (!memory_add_region((void*)(uintptr_t)base, large_count * FRAME_LARGE_SIZE)) {
+                frame_free_contiguous(base, large_count);
+            }
+            return;
+        }
+        large_count /= 2;
+    }
+}
+
+// Main kernel function - called from assembly with the multiboot handoff
+void kernel_main(uint32_t multiboot_magic, uint32_t multiboot_info) {
     // Initialize the terminal
     terminal_initialize();
     
@@ -36,8 +66,16 @@ void kernel_main(void) {
     terminal_setcolor(make_vga_color(VGA_COLOR_LIGHT_BROWN, VGA_COLOR_BLACK));
     terminal_writestring("YAY!\n\n");
 
+    // Initialize physical memory from the bootloader's memory map
+    frame_init(multiboot_magic, multiboot_info);
+    vmm_init();
+    gdt_init();
+    idt_init();
+    pic_init();
+
     // Initialize memory management
     memory_init();
+    kernel_add_heap_region();
 
     // Initialize ramdisk
     terminal_writestring("Initializing ramdisk...\n");
@@ -57,6 +95,11 @@ void kernel_main(void) {
     // Initialize mouse
     mouse_init();
 
+    // Start the system tick and calibrate the TSC against the PIT while
+    // interrupts are still off
+    timer_init();
+    clock_init();
+
     // Initialize VGA graphics (starts in text mode)
     vga_init();
     terminal_writestring("VGA graphics driver initialized\n");
@@ -64,6 +107,9 @@ void kernel_main(void) {
     // Initialize process management
     process_init();
 
+    // Drivers have claimed their IRQs
+    __asm__ volatile("sti");
+
     // Create kernel process (but don't run it yet)
     // Priority is LOW so it only runs when nothing else is ready
     process_t* kernel_proc = process_create("kernel", kernel_process_main, NULL, 
@@ -95,11 +141,7 @@ void kernel_main(void) {
     terminal_writestring("Kernel: Handing over to scheduler...\n");
     process_schedule();
 
-    // This becomes the idle loop for the kernel process
+    // kernel_main runs as the kernel process, so its idle loop is this one
     terminal_writestring("Kernel: Entered idle loop (multitasking active)\n");
-    while (1) {
-        process_yield();
-        // We cannot use hlt here because we don't have interrupts enabled yet
-        // __asm__ volatile("hlt"); 
-    }
+    kernel_process_main(NULL);
 }
@@ -3,21 +3,580 @@
 #include "string.h"
 #include "memory_utils.h"
 
-// Memory pool - our simple heap
-static char memory_pool[MEMORY_POOL_SIZE];
-static memory_block_t* memory_list = NULL;
+// Memory pool - our simple heap, handed out in buddy blocks
+static char memory_pool[MEMORY_POOL_SIZE] __attribute__((aligned(BUDDY_PAGE_SIZE)));
+static buddy_page_t pool_pages[MEMORY_POOL_SIZE / BUDDY_PAGE_SIZE];
 static int memory_initialized = 0;
 
+// Buddy zones: zone 0 is the static pool, later zones are physical memory
+// regions handed over with memory_add_region
+static buddy_zone_t zones[MEMORY_MAX_ZONES];
+static int zone_count = 0;
+
+// TLSF heap arenas (buddy blocks holding the small-object heap)
+typedef struct {
+    char* base;
+    size_t size;
+} memory_arena_t;
+
+static memory_arena_t heap_arenas[MEMORY_MAX_ARENAS];
+static int heap_arena_count = 0;
+
+// TLSF free-list index: a first-level bitmap of non-empty size classes,
+// a second-level bitmap per class and the list heads themselves
+static uint32_t fl_bitmap = 0;
+static uint32_t sl_bitmap[MEMORY_FL_INDEX_COUNT];
+static memory_block_t* free_lists[MEMORY_FL_INDEX_COUNT][MEMORY_SL_INDEX_COUNT];
+
+// Telemetry kept up to date by the allocator itself; the free-list byte
+// count and histogram cover the TLSF arenas, the buddy zone counts its own
+static memory_stats_t heap_stats;
+static size_t heap_free_bytes = 0;
+static uint32_t heap_free_histogram[MEMORY_HISTOGRAM_BUCKETS];
+
+// Index of the most/least significant set bit (word must be non-zero)
+static inline int memory_fls(size_t word) {
+    return 63 - __builtin_clzl(word);
+}
+
+static inline int memory_ffs(uint32_t word) {
+    return __builtin_ctz(word);
+}
+
+static inline memory_block_t* block_from_ptr(void* ptr) {
+    return (memory_block_t*)((char*)ptr - MEMORY_BLOCK_SIZE);
+}
+
+static inline void* block_to_ptr(memory_block_t* block) {
+    return (char*)block + MEMORY_BLOCK_SIZE;
+}
+
+// Boundary-tag accessors
+static inline size_t block_size(const memory_block_t* block) {
+    return block->size & ~(size_t)MEMORY_BLOCK_FLAGS;
+}
+
+static inline void block_set_size(memory_block_t* block, size_t size) {
+    block->size = size | (block->size & MEMORY_BLOCK_FLAGS);
+}
+
+static inline int block_is_free(const memory_block_t* block) {
+    return (block->size & MEMORY_BLOCK_FREE) != 0;
+}
+
+static inline int block_is_prev_free(const memory_block_t* block) {
+    return (block->size & MEMORY_BLOCK_PREV_FREE) != 0;
+}
+
+// Physically following block (the pool ends with a zero-sized sentinel)
+static inline memory_block_t* block_next_phys(memory_block_t* block) {
+    return (memory_block_t*)((char*)block + MEMORY_BLOCK_SIZE + block_size(block));
+}
+
+// Physically preceding block, located through its footer (prev must be free)
+static inline memory_block_t* block_prev_phys(memory_block_t* block) {
+    size_t prev_size = ((size_t*)block)[-1];
+    return (memory_block_t*)((char*)block - prev_size - MEMORY_BLOCK_SIZE);
+}
+
+// Mark a block free: write its footer and tell the successor
+static void block_mark_free(memory_block_t* block) {
+    size_t size = block_size(block);
+    block->size |= MEMORY_BLOCK_FREE;
+    block->magic = MEMORY_MAGIC_FREE;
+    *(size_t*)((char*)block_to_ptr(block) + size - sizeof(size_t)) = size;
+    block_next_phys(block)->size |= MEMORY_BLOCK_PREV_FREE;
+}
+
+static void block_mark_used(memory_block_t* block) {
+    block->size &= ~(size_t)MEMORY_BLOCK_FREE;
+    block->magic = MEMORY_MAGIC_USED;
+    block->reserved = 0;
+    block_next_phys(block)->size &= ~(size_t)MEMORY_BLOCK_PREV_FREE;
+}
+
+// Map a block size to the free list that holds blocks of that size
+static void mapping_insert(size_t size, int* fl, int* sl) {
+    if (size < MEMORY_SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = (int)(size / (MEMORY_SMALL_BLOCK_SIZE / MEMORY_SL_INDEX_COUNT));
+    } else {
+        int bit = memory_fls(size);
+        *sl = (int)(size >> (bit - MEMORY_SL_INDEX_COUNT_LOG2)) ^ MEMORY_SL_INDEX_COUNT;
+        *fl = bit - (MEMORY_FL_INDEX_SHIFT - 1);
+    }
+}
+
+// Map a request to the first list whose blocks are all large enough
+static void mapping_search(size_t size, int* fl, int* sl) {
+    if (size >= MEMORY_SMALL_BLOCK_SIZE) {
+        size += ((size_t)1 << (memory_fls(size) - MEMORY_SL_INDEX_COUNT_LOG2)) - 1;
+    }
+    mapping_insert(size, fl, sl);
+}
+
+// Histogram bucket for a free block of the given size
+static inline int memory_histogram_bucket(size_t size) {
+    int bucket = memory_fls(size) - MEMORY_HISTOGRAM_MIN_SHIFT;
+    if (bucket < 0) {
+        return 0;
+    }
+    if (bucket >= MEMORY_HISTOGRAM_BUCKETS) {
+        return MEMORY_HISTOGRAM_BUCKETS - 1;
+    }
+    return bucket;
+}
+
+static void free_list_insert(memory_block_t* block) {
+    int fl, sl;
+    mapping_insert(block_size(block), &fl, &sl);
+
+    memory_block_t* head = free_lists[fl][sl];
+    block->next_free = head;
+    block->prev_free = NULL;
+    if (head) {
+        head->prev_free = block;
+    }
+    free_lists[fl][sl] = block;
+
+    fl_bitmap |= 1U << fl;
+    sl_bitmap[fl] |= 1U << sl;
+    
+    heap_free_bytes += block_size(block);
+    heap_free_histogram[memory_histogram_bucket(block_size(block))]++;
+}
+
+static void free_list_remove(memory_block_t* block) {
+    int fl, sl;
+    mapping_insert(block_size(block), &fl, &sl);
+
+    if (block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        free_lists[fl][sl] = block->next_free;
+        if (!free_lists[fl][sl]) {
+            sl_bitmap[fl] &= ~(1U << sl);
+            if (!sl_bitmap[fl]) {
+                fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    if (block->next_free) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    
+    heap_free_bytes -= block_size(block);
+    heap_free_histogram[memory_histogram_bucket(block_size(block))]--;
+}
+
+// Find a non-empty list at or above (fl, sl) using the bitmaps
+static memory_block_t* find_suitable_block(int fl, int sl) {
+    if (fl >= MEMORY_FL_INDEX_COUNT) {
+        return NULL;
+    }
+
+    uint32_t sl_map = sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        // Nothing in this class - move to the next non-empty first level
+        uint32_t fl_map = fl_bitmap & (~0U << (fl + 1));
+        if (!fl_map) {
+            return NULL;
+        }
+        fl = memory_ffs(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = memory_ffs(sl_map);
+    return free_lists[fl][sl];
+}
+
+// Absorb the physically following block into this one
+static void block_absorb(memory_block_t* block, memory_block_t* next) {
+    block_set_size(block, block_size(block) + MEMORY_BLOCK_SIZE + block_size(next));
+}
+
+// Trim a used block down to size, returning the tail to the free lists
+static void block_split(memory_block_t* block, size_t size) {
+    size_t total = block_size(block);
+    if (total < size + MEMORY_BLOCK_SIZE + MEMORY_MIN_BLOCK_SIZE) {
+        return;
+    }
+
+    memory_block_t* remainder = (memory_block_t*)((char*)block + MEMORY_BLOCK_SIZE + size);
+    remainder->size = total - size - MEMORY_BLOCK_SIZE;  // Predecessor is in use
+    block_set_size(block, size);
+
+    // A shrinking krealloc can leave the tail next to a free block
+    memory_block_t* next = block_next_phys(remainder);
+    if (block_is_free(next)) {
+        free_list_remove(next);
+        block_absorb(remainder, next);
+    }
+
+    block_mark_free(remainder);
+    free_list_insert(remainder);
+}
+
+// Zone whose region holds ptr, or NULL
+static buddy_zone_t* memory_find_zone(const void* ptr) {
+    for (int i = 0; i < zone_count; i++) {
+        if (buddy_owns(&zones[i], ptr)) {
+            return &zones[i];
+        }
+    }
+    return NULL;
+}
+
+// Buddy block from the first zone that has one of this order
+static void* memory_buddy_alloc(int order) {
+    for (int i = 0; i < zone_count; i++) {
+        void* ptr = buddy_alloc(&zones[i], order);
+        if (ptr) {
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+static int memory_buddy_free(void* ptr) {
+    buddy_zone_t* zone = memory_find_zone(ptr);
+    return zone && buddy_free(zone, ptr);
+}
+
+// Carve a buddy block into a TLSF arena: one free block followed by a
+// zero-sized used sentinel so every block has a valid physical successor
+static int memory_add_arena(size_t size) {
+    if (heap_arena_count >= MEMORY_MAX_ARENAS) {
+        return 0;
+    }
+    
+    char* base = (char*)memory_buddy_alloc(buddy_order_for_size(size));
+    if (!base) {
+        return 0;
+    }
+    
+    memory_block_t* sentinel = (memory_block_t*)(base + size - MEMORY_BLOCK_SIZE);
+    sentinel->size = 0;
+    sentinel->magic = MEMORY_MAGIC_USED;
+    
+    memory_block_t* block = (memory_block_t*)base;
+    block->size = size - 2 * MEMORY_BLOCK_SIZE;
+    block_mark_free(block);
+    free_list_insert(block);
+    
+    heap_arenas[heap_arena_count].base = base;
+    heap_arenas[heap_arena_count].size = size;
+    heap_arena_count++;
+    return 1;
+}
+
+// Arena holding ptr, or -1 if ptr is not in the TLSF heap
+static int memory_find_arena(const void* ptr) {
+    for (int i = 0; i < heap_arena_count; i++) {
+        if ((const char*)ptr >= heap_arenas[i].base &&
+            (const char*)ptr < heap_arenas[i].base + heap_arenas[i].size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void memory_free(void* ptr);
+
+// Block bytes behind a live allocation, or 0 if ptr is not allocated
+static size_t memory_block_bytes(void* ptr) {
+    if (!ptr) {
+        return 0;
+    }
+    if (memory_find_arena(ptr) >= 0) {
+        memory_block_t* block = block_from_ptr(ptr);
+        if (block->magic != MEMORY_MAGIC_USED || block_is_free(block)) {
+            return 0;
+        }
+        return block_size(block);
+    }
+    buddy_zone_t* zone = memory_find_zone(ptr);
+    return zone ? buddy_block_size(zone, ptr) : 0;
+}
+
+static void memory_account_alloc(size_t bytes) {
+    if (!bytes) {
+        return;
+    }
+    heap_stats.allocated_bytes += bytes;
+    if (heap_stats.allocated_bytes > heap_stats.peak_allocated) {
+        heap_stats.peak_allocated = heap_stats.allocated_bytes;
+    }
+    heap_stats.active_allocations++;
+    heap_stats.alloc_count++;
+}
+
+static void memory_account_free(size_t bytes) {
+    if (!bytes) {
+        return;
+    }
+    heap_stats.allocated_bytes -= bytes;
+    heap_stats.active_allocations--;
+    heap_stats.free_count++;
+}
+
+#if MEMORY_PROFILE
+// Call-site profile: an open-addressed table keyed by caller address. Each
+// live block remembers its site (index + 1) in the spare header word, or in
+// a small table of live buddy blocks, so kfree can charge the right site.
+#define MEMORY_PROFILE_LARGE 64
+
+typedef struct {
+    void* ptr;
+    uint32_t site;
+} memory_large_site_t;
+
+static memory_site_t profile_sites[MEMORY_PROFILE_SITES];
+static memory_large_site_t large_sites[MEMORY_PROFILE_LARGE];
+
+// Site slot of a live buddy block, claiming a free entry if asked to
+static uint32_t* memory_profile_large_slot(void* ptr, int create) {
+    memory_large_site_t* unused = NULL;
+    for (int i = 0; i < MEMORY_PROFILE_LARGE; i++) {
+        if (large_sites[i].ptr == ptr) {
+            return &large_sites[i].site;
+        }
+        if (!large_sites[i].ptr && !unused) {
+            unused = &large_sites[i];
+        }
+    }
+    if (!create || !unused) {
+        return NULL; // Table full - the allocation goes untracked
+    }
+    unused->ptr = ptr;
+    unused->site = 0;
+    return &unused->site;
+}
+
+// Site slot of a live block and its size, or NULL if ptr is not allocated
+static uint32_t* memory_profile_slot(void* ptr, size_t* bytes, int create) {
+    if (!ptr) {
+        return NULL;
+    }
+    
+    if (memory_find_arena(ptr) >= 0) {
+        memory_block_t* block = block_from_ptr(ptr);
+        if (block->magic != MEMORY_MAGIC_USED || block_is_free(block)) {
+            return NULL;
+        }
+        *bytes = block_size(block);
+        return &block->reserved;
+    }
+    
+    buddy_zone_t* zone = memory_find_zone(ptr);
+    *bytes = zone ? buddy_block_size(zone, ptr) : 0;
+    if (!*bytes) {
+        return NULL;
+    }
+    return memory_profile_large_slot(ptr, create);
+}
+
+static memory_site_t* memory_profile_site(void* caller) {
+    uint32_t index = (uint32_t)(((uintptr_t)caller >> 2) * 2654435761u) & (MEMORY_PROFILE_SITES - 1);
+    
+    for (int probe = 0; probe < MEMORY_PROFILE_SITES; probe++) {
+        memory_site_t* site = &profile_sites[index];
+        if (site->caller == caller) {
+            return site;
+        }
+        if (!site->caller) {
+            site->caller = caller;
+            site->min_size = (size_t)-1;
+            return site;
+        }
+        index = (index + 1) & (MEMORY_PROFILE_SITES - 1);
+    }
+    return NULL; // Table full - the allocation goes untracked
+}
+
+static void memory_profile_alloc(void* ptr, size_t size, void* caller) {
+    size_t bytes;
+    uint32_t* slot = memory_profile_slot(ptr, &bytes, 1);
+    if (!slot) {
+        return;
+    }
+    
+    memory_site_t* site = memory_profile_site(caller);
+    if (!site) {
+        *slot = 0;
+        return;
+    }
+    *slot = (uint32_t)(site - profile_sites) + 1;
+    
+    site->alloc_count++;
+    site->total_bytes += bytes;
+    site->live_bytes += bytes;
+    if (site->live_bytes > site->peak_bytes) {
+        site->peak_bytes = site->live_bytes;
+    }
+    if (size < site->min_size) {
+        site->min_size = size;
+    }
+    if (size > site->max_size) {
+        site->max_size = size;
+    }
+}
+
+// Site charged for a live block and its size, leaving the record in place
+static uint32_t memory_profile_peek(void* ptr, size_t* bytes) {
+    uint32_t* slot = memory_profile_slot(ptr, bytes, 0);
+    if (!slot) {
+        *bytes = 0;
+        return 0;
+    }
+    return *slot;
+}
+
+// Charge a free to the site a block was recorded against. The block may
+// already be resized or gone, so nothing is read from it.
+static void memory_profile_release(void* ptr, uint32_t site_index, size_t bytes) {
+    if (!ptr) {
+        return;
+    }
+    
+    if (site_index && site_index <= MEMORY_PROFILE_SITES) {
+        memory_site_t* site = &profile_sites[site_index - 1];
+        site->free_count++;
+        site->live_bytes -= bytes;
+    }
+    
+    // Buddy blocks give their table entry back
+    if (memory_find_arena(ptr) < 0) {
+        for (int i = 0; i < MEMORY_PROFILE_LARGE; i++) {
+            if (large_sites[i].ptr == ptr) {
+                large_sites[i].ptr = NULL;
+            }
+        }
+    }
+}
+
+static void memory_profile_free(void* ptr) {
+    size_t bytes;
+    uint32_t* slot = memory_profile_slot(ptr, &bytes, 0);
+    if (!slot) {
+        return;
+    }
+    
+    uint32_t site_index = *slot;
+    *slot = 0;
+    memory_profile_release(ptr, site_index, bytes);
+}
+
+#define MEMORY_PROFILE_ALLOC(ptr, size) \
+    memory_profile_alloc((ptr), (size), __builtin_return_address(0))
+#define MEMORY_PROFILE_FREE(ptr) memory_profile_free(ptr)
+#define MEMORY_PROFILE_PEEK(ptr, bytes) memory_profile_peek((ptr), &(bytes))
+#define MEMORY_PROFILE_RELEASE(ptr, site, bytes) memory_profile_release((ptr), (site), (bytes))
+#else
+#define MEMORY_PROFILE_ALLOC(ptr, size) ((void)0)
+#define MEMORY_PROFILE_FREE(ptr) ((void)0)
+#define MEMORY_PROFILE_PEEK(ptr, bytes) ((bytes) = 0, 0u)
+#define MEMORY_PROFILE_RELEASE(ptr, site, bytes) ((void)(site), (void)(bytes))
+#endif
+
+#if MEMORY_TRACE
+// Trace ring buffer; when it wraps the oldest entries are overwritten
+static memory_trace_entry_t trace_ring[MEMORY_TRACE_ENTRIES];
+static uint32_t trace_head = 0;
+static uint32_t trace_count = 0;
+static uint32_t trace_dropped = 0;
+static int trace_enabled = 0;
+
+static inline uint64_t memory_trace_tsc(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline uint32_t memory_trace_id(const void* ptr) {
+    buddy_zone_t* zone = memory_find_zone(ptr);
+    if (!zone) {
+        return 0;
+    }
+    uint32_t offset = (uint32_t)(((uintptr_t)ptr - zone->base) >> MEMORY_ALIGN_LOG2);
+    return ((uint32_t)(zone - zones) << 24 | offset) + 1;
+}
+
+static void memory_trace_record(memory_trace_op_t op, void* ptr, void* old_ptr,
+                                size_t size, size_t align) {
+    memory_trace_entry_t* entry = &trace_ring[trace_head];
+    entry->timestamp = memory_trace_tsc();
+    entry->id = memory_trace_id(ptr);
+    entry->old_id = memory_trace_id(old_ptr);
+    entry->size = (uint32_t)size;
+    entry->align = (uint16_t)align;
+    entry->op = (uint8_t)op;
+    entry->reserved = 0;
+    
+    trace_head = (trace_head + 1) & (MEMORY_TRACE_ENTRIES - 1);
+    if (trace_count < MEMORY_TRACE_ENTRIES) {
+        trace_count++;
+    } else {
+        trace_dropped++;
+    }
+}
+
+#define MEMORY_TRACE_RECORD(op, ptr, old_ptr, size, align) \
+    do { \
+        if (trace_enabled) { \
+            memory_trace_record((op), (ptr), (old_ptr), (size), (align)); \
+        } \
+    } while (0)
+#else
+#define MEMORY_TRACE_RECORD(op, ptr, old_ptr, size, align) ((void)0)
+#endif
+
+// Keep payloads MEMORY_ALIGN aligned and large enough to hold the
+// free-list links and footer once they are released
+static size_t memory_adjust_size(size_t size) {
+    size = (size + MEMORY_ALIGN - 1) & ~(size_t)(MEMORY_ALIGN - 1);
+    if (size < MEMORY_MIN_BLOCK_SIZE) {
+        size = MEMORY_MIN_BLOCK_SIZE;
+    }
+    return size;
+}
+
+// Remove a free block of at least size bytes from the free lists, growing
+// the heap by another arena if none is left
+static memory_block_t* memory_take_block(size_t size) {
+    // Good-fit lookup: two bitmap scans pick a list whose head is big enough
+    int fl, sl;
+    mapping_search(size, &fl, &sl);
+    memory_block_t* block = find_suitable_block(fl, sl);
+    if (!block) {
+        if (!memory_add_arena(MEMORY_HEAP_ARENA_SIZE)) {
+            return NULL;
+        }
+        block = find_suitable_block(fl, sl);
+        if (!block) {
+            return NULL;
+        }
+    }
+    
+    free_list_remove(block);
+    return block;
+}
+
 void memory_init(void) {
     if (memory_initialized) {
         return;
     }
     
-    // Initialize the first memory block
-    memory_list = (memory_block_t*)memory_pool;
-    memory_list->size = MEMORY_POOL_SIZE - MEMORY_BLOCK_SIZE;
-    memory_list->is_free = 1;
-    memory_list->next = NULL;
+    memset(sl_bitmap, 0, sizeof(sl_bitmap));
+    memset(free_lists, 0, sizeof(free_lists));
+    fl_bitmap = 0;
+    heap_arena_count = 0;
+    memset(&heap_stats, 0, sizeof(heap_stats));
+    memset(heap_free_histogram, 0, sizeof(heap_free_histogram));
+    heap_free_bytes = 0;
+    
+    buddy_init(&zones[0], memory_pool, MEMORY_POOL_SIZE, pool_pages);
+    zone_count = 1;
+    memory_add_arena(MEMORY_HEAP_ARENA_SIZE);
     
     memory_initialized = 1;
     
@@ -29,114 +588,434 @@ void memory_init(void) {
     terminal_writestring(" bytes\n");
 }
 
-void* kmalloc(size_t size) {
+// Hand a page-aligned region of memory to the allocator as a new buddy
+// zone. Its page map is carved from the start of the region.
+int memory_add_region(void* base, size_t size) {
     if (!memory_initialized) {
         memory_init();
     }
     
-    if (size == 0) {
+    if (zone_count >= MEMORY_MAX_ZONES || ((uintptr_t)base & (BUDDY_PAGE_SIZE - 1))) {
+        return 0;
+    }
+    if (size > MEMORY_REGION_MAX_SIZE) {
+        size = MEMORY_REGION_MAX_SIZE;
+    }
+    
+    size_t map_bytes = (size / BUDDY_PAGE_SIZE) * sizeof(buddy_page_t);
+    map_bytes = (map_bytes + BUDDY_PAGE_SIZE - 1) & ~(size_t)(BUDDY_PAGE_SIZE - 1);
+    if (size < map_bytes + BUDDY_PAGE_SIZE) {
+        return 0;
+    }
+    
+    buddy_init(&zones[zone_count], (char*)base + map_bytes, size - map_bytes, (buddy_page_t*)base);
+    zone_count++;
+    
+    terminal_writestring("Memory manager added ");
+    char size_str[32];
+    uint32_to_string((size - map_bytes) / 1024, size_str);
+    terminal_writestring(size_str);
+    terminal_writestring(" KB region\n");
+    return 1;
+}
+
+static void* memory_alloc(size_t size) {
+    if (!memory_initialized) {
+        memory_init();
+    }
+    
+    if (size == 0 || size > MEMORY_MAX_ALLOC) {
         return NULL;
     }
     
-    // Align size to 4 bytes for better performance
-    size = (size + 3) & ~3;
+    // Page-sized and larger requests get a buddy block of their own
+    if (size >= MEMORY_LARGE_ALLOC) {
+        return memory_buddy_alloc(buddy_order_for_size(size));
+    }
     
-    memory_block_t* current = memory_list;
+    size = memory_adjust_size(size);
+    memory_block_t* block = memory_take_block(size);
+    if (!block) {
+        return NULL;
+    }
     
-    // First-fit allocation strategy
-    while (current != NULL) {
-        if (current->is_free && current->size >= size) {
-            // Split the block if it's much larger than needed
-            if (current->size > size + MEMORY_BLOCK_SIZE + 16) {
-                memory_block_t* new_block = (memory_block_t*)((char*)current + MEMORY_BLOCK_SIZE + size);
-                new_block->size = current->size - size - MEMORY_BLOCK_SIZE;
-                new_block->is_free = 1;
-                new_block->next = current->next;
-                
-                current->size = size;
-                current->next = new_block;
-            }
-            
-            current->is_free = 0;
-            
-            return (char*)current + MEMORY_BLOCK_SIZE;
+    block_mark_used(block);
+    block_split(block, size);
+    
+    return block_to_ptr(block);
+}
+
+static void* memory_realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return memory_alloc(size);
+    }
+    if (size == 0) {
+        memory_free(ptr);
+        return NULL;
+    }
+    if (size > MEMORY_MAX_ALLOC) {
+        return NULL;
+    }
+    
+    size_t old_size;
+    if (memory_find_arena(ptr) >= 0) {
+        memory_block_t* block = block_from_ptr(ptr);
+        if (block->magic != MEMORY_MAGIC_USED || block_is_free(block)) {
+            terminal_writestring("WARNING: krealloc of a block that is not allocated\n");
+            return NULL;
+        }
+        
+        // Grow into a free physical successor, or shrink by splitting
+        size_t adjusted = memory_adjust_size(size);
+        old_size = block_size(block);
+        memory_block_t* next = block_next_phys(block);
+        if (adjusted > old_size && block_is_free(next) &&
+            old_size + MEMORY_BLOCK_SIZE + block_size(next) >= adjusted) {
+            free_list_remove(next);
+            block_absorb(block, next);
+            block_mark_used(block);
+        }
+        if (adjusted <= block_size(block)) {
+            block_split(block, adjusted);
+            return ptr;
+        }
+    } else {
+        buddy_zone_t* zone = memory_find_zone(ptr);
+        old_size = zone ? buddy_block_size(zone, ptr) : 0;
+        if (!old_size) {
+            terminal_writestring("WARNING: krealloc of a block that is not allocated\n");
+            return NULL;
+        }
+        
+        // Large blocks resize in place within the buddy system; shrinking
+        // below a page moves the data back to the heap
+        if (size >= MEMORY_LARGE_ALLOC &&
+            buddy_resize(zone, ptr, buddy_order_for_size(size))) {
+            return ptr;
         }
-        current = current->next;
     }
     
-    // No suitable block found
-    return NULL;
+    // Neither worked - move the data to a new block
+    void* new_ptr = memory_alloc(size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    memory_free(ptr);
+    return new_ptr;
 }
 
-void kfree(void* ptr) {
+static void* memory_alloc_aligned(size_t size, size_t align) {
+    if (!memory_initialized) {
+        memory_init();
+    }
+    
+    if (size == 0 || size > MEMORY_MAX_ALLOC || (align & (align - 1)) || align > MEMORY_PAGE_SIZE) {
+        return NULL;
+    }
+    
+    // Every block is already MEMORY_ALIGN aligned, and buddy blocks are
+    // page aligned
+    if (align <= MEMORY_ALIGN) {
+        return memory_alloc(size);
+    }
+    if (size >= MEMORY_LARGE_ALLOC || align == MEMORY_PAGE_SIZE) {
+        return memory_buddy_alloc(buddy_order_for_size(size));
+    }
+    
+    // Ask for enough to fit an aligned block after a leading gap that is
+    // itself big enough to become a free block
+    size = memory_adjust_size(size);
+    size_t gap_min = MEMORY_BLOCK_SIZE + MEMORY_MIN_BLOCK_SIZE;
+    memory_block_t* block = memory_take_block(size + align + gap_min);
+    if (!block) {
+        return NULL;
+    }
+    
+    uintptr_t ptr = (uintptr_t)block_to_ptr(block);
+    uintptr_t aligned = (ptr + align - 1) & ~(uintptr_t)(align - 1);
+    while (aligned != ptr && aligned - ptr < gap_min) {
+        aligned += align;
+    }
+    
+    // Give the leading gap back as a free block instead of keeping it as
+    // slack, so an aligned allocation costs no more than its own size
+    if (aligned != ptr) {
+        size_t gap = aligned - ptr;
+        memory_block_t* aligned_block = block_from_ptr((void*)aligned);
+        aligned_block->size = block_size(block) - gap;
+        block_set_size(block, gap - MEMORY_BLOCK_SIZE);
+        block_mark_free(block);
+        free_list_insert(block);
+        block = aligned_block;
+    }
+    
+    block_mark_used(block);
+    block_split(block, size);
+    
+    return block_to_ptr(block);
+}
+
+static void memory_free(void* ptr) {
     if (ptr == NULL) {
         return;
     }
     
-    memory_block_t* block = (memory_block_t*)((char*)ptr - MEMORY_BLOCK_SIZE);
+    int arena = memory_find_arena(ptr);
+    if (arena < 0) {
+        // Not a heap pointer - it must be a large buddy allocation
+        if (!memory_buddy_free(ptr)) {
+            terminal_writestring("WARNING: kfree of a block that is not allocated\n");
+        }
+        return;
+    }
+    
+    memory_block_t* block = block_from_ptr(ptr);
     
     // Validate that this is actually a block header
-    if (block < (memory_block_t*)memory_pool || 
-        (char*)block >= memory_pool + MEMORY_POOL_SIZE) {
+    if ((char*)block < heap_arenas[arena].base || ((uintptr_t)ptr & (MEMORY_ALIGN - 1))) {
         return; // Invalid pointer
     }
     
-    if (block->is_free) {
-        return; // Already freed
+    // The magic catches double frees (and pointers into the middle of a
+    // block) without walking the heap
+    if (block->magic != MEMORY_MAGIC_USED || block_is_free(block)) {
+        terminal_writestring("WARNING: kfree of a block that is not allocated\n");
+        return;
+    }
+    
+    // Coalesce with free physical neighbours using the boundary tags
+    if (block_is_prev_free(block)) {
+        memory_block_t* prev = block_prev_phys(block);
+        free_list_remove(prev);
+        block->magic = MEMORY_MAGIC_FREE;
+        block_absorb(prev, block);
+        block = prev;
     }
     
-    block->is_free = 1;
+    memory_block_t* next = block_next_phys(block);
+    if (block_is_free(next)) {
+        free_list_remove(next);
+        block_absorb(block, next);
+    }
     
-    // Coalesce adjacent free blocks
-    memory_block_t* current = memory_list;
-    while (current != NULL && current->next != NULL) {
-        if (current->is_free && current->next->is_free) {
-            // Merge current with next
-            current->size += current->next->size + MEMORY_BLOCK_SIZE;
-            current->next = current->next->next;
-        } else {
-            current = current->next;
+    // Hand a completely free extra arena back to the buddy allocator
+    if ((char*)block == heap_arenas[arena].base && block_size(block_next_phys(block)) == 0 &&
+        heap_arena_count > 1) {
+        memory_buddy_free(heap_arenas[arena].base);
+        heap_arenas[arena] = heap_arenas[--heap_arena_count];
+        return;
+    }
+    
+    block_mark_free(block);
+    free_list_insert(block);
+}
+
+void* kmalloc(size_t size) {
+    void* ptr = memory_alloc(size);
+    memory_account_alloc(memory_block_bytes(ptr));
+    MEMORY_PROFILE_ALLOC(ptr, size);
+    MEMORY_TRACE_RECORD(MEMORY_TRACE_ALLOC, ptr, NULL, size, 0);
+    return ptr;
+}
+
+// kmalloc returning cleared memory. Page-sized buffers that only need to
+// be mapped should use frame_alloc_zeroed, which is usually pre-cleared.
+void* kzalloc(size_t size) {
+    void* ptr = kmalloc(size);
+    if (ptr) {
+        // Much faster than the byte-at-a-time memset for large blocks
+        void* dest = ptr;
+        size_t count = size;
+        __asm__ volatile("rep stosb" : "+D"(dest), "+c"(count) : "a"(0) : "memory");
+    }
+    return ptr;
+}
+
+void* kmalloc_aligned(size_t size, size_t align) {
+    void* ptr = memory_alloc_aligned(size, align);
+    memory_account_alloc(memory_block_bytes(ptr));
+    MEMORY_PROFILE_ALLOC(ptr, size);
+    MEMORY_TRACE_RECORD(MEMORY_TRACE_ALLOC, ptr, NULL, size, align);
+    return ptr;
+}
+
+void* krealloc(void* ptr, size_t size) {
+    // The old block keeps its profile record unless the resize succeeds
+    size_t profile_bytes;
+    uint32_t profile_site = MEMORY_PROFILE_PEEK(ptr, profile_bytes);
+    size_t old_bytes = memory_block_bytes(ptr);
+    void* result = memory_realloc(ptr, size);
+    if (result) {
+        MEMORY_PROFILE_RELEASE(ptr, profile_site, profile_bytes);
+        // A resize counts as neither an allocation nor a free
+        heap_stats.allocated_bytes += memory_block_bytes(result) - old_bytes;
+        if (heap_stats.allocated_bytes > heap_stats.peak_allocated) {
+            heap_stats.peak_allocated = heap_stats.allocated_bytes;
+        }
+        if (!old_bytes) {
+            heap_stats.active_allocations++;
+            heap_stats.alloc_count++;
         }
+        MEMORY_PROFILE_ALLOC(result, size);
+    } else if (!size) {
+        MEMORY_PROFILE_RELEASE(ptr, profile_site, profile_bytes);
+        memory_account_free(old_bytes);
     }
+    MEMORY_TRACE_RECORD(MEMORY_TRACE_REALLOC, result, ptr, size, 0);
+    return result;
 }
 
-void memory_print_stats(void) {
-    terminal_writestring("=== Memory Statistics ===\n");
+void kfree(void* ptr) {
+    MEMORY_PROFILE_FREE(ptr);
+    MEMORY_TRACE_RECORD(MEMORY_TRACE_FREE, ptr, NULL, 0, 0);
+    memory_account_free(memory_block_bytes(ptr));
+    memory_free(ptr);
+}
+
+void memory_get_stats(memory_stats_t* stats) {
+    if (!memory_initialized) {
+        memory_init();
+    }
     
-    // Calculate heap statistics on-demand
-    size_t total_allocated = 0;
-    size_t total_free = 0;
-    size_t allocation_count = 0;
+    *stats = heap_stats;
+    stats->total_bytes = 0;
+    stats->free_bytes = heap_free_bytes;
+    for (int i = 0; i < zone_count; i++) {
+        stats->total_bytes += zones[i].page_count * BUDDY_PAGE_SIZE;
+        stats->free_bytes += zones[i].free_pages * BUDDY_PAGE_SIZE;
+    }
     
-    memory_block_t* block = memory_list;
-    while (block) {
-        if (block->is_free) {
-            total_free += block->size;
-        } else {
-            total_allocated += block->size;
-            allocation_count++;
+    // The largest TLSF block sits in the highest non-empty list; only that
+    // one list is scanned
+    size_t largest = 0;
+    if (fl_bitmap) {
+        int fl = 31 - __builtin_clz(fl_bitmap);
+        int sl = 31 - __builtin_clz(sl_bitmap[fl]);
+        for (memory_block_t* block = free_lists[fl][sl]; block; block = block->next_free) {
+            if (block_size(block) > largest) {
+                largest = block_size(block);
+            }
         }
-        block = block->next;
     }
+    for (int i = 0; i < zone_count; i++) {
+        int order = buddy_largest_free_order(&zones[i]);
+        if (order >= 0 && ((size_t)BUDDY_PAGE_SIZE << order) > largest) {
+            largest = (size_t)BUDDY_PAGE_SIZE << order;
+        }
+    }
+    stats->largest_free = largest;
+    stats->fragmentation = stats->free_bytes ?
+        (uint32_t)(100 - largest * 100 / stats->free_bytes) : 0;
+    
+    for (int i = 0; i < MEMORY_HISTOGRAM_BUCKETS; i++) {
+        stats->free_histogram[i] = heap_free_histogram[i];
+    }
+    for (int z = 0; z < zone_count; z++) {
+        for (int i = 0; i <= BUDDY_MAX_ORDER; i++) {
+            stats->free_histogram[memory_histogram_bucket((size_t)BUDDY_PAGE_SIZE << i)] += zones[z].free_blocks[i];
+        }
+    }
+}
+
+// Aligned blocks are ordinary heap or buddy blocks
+void kfree_aligned(void* ptr) {
+    kfree(ptr);
+}
+
+void memory_print_stats(void) {
+    terminal_writestring("=== Memory Statistics ===\n");
+    
+    // Totals come from the incrementally maintained counters; nothing here
+    // walks the heap
+    memory_stats_t stats;
+    memory_get_stats(&stats);
     
-    // Heap statistics
     terminal_writestring("HEAP MEMORY:\n");
     terminal_writestring("  Allocated: ");
     char buffer[32];
-    uint32_to_string(total_allocated, buffer);
+    uint32_to_string(stats.allocated_bytes, buffer);
     terminal_writestring(buffer);
-    terminal_writestring(" bytes\n");
+    terminal_writestring(" bytes (peak ");
+    uint32_to_string(stats.peak_allocated, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(")\n");
     
     terminal_writestring("  Free: ");
-    uint32_to_string(total_free, buffer);
+    uint32_to_string(stats.free_bytes, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" bytes\n");
+    
+    terminal_writestring("  Largest free block: ");
+    uint32_to_string(stats.largest_free, buffer);
     terminal_writestring(buffer);
     terminal_writestring(" bytes\n");
     
+    terminal_writestring("  Fragmentation: ");
+    uint32_to_string(stats.fragmentation, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring("%\n");
+    
     terminal_writestring("  Active allocations: ");
-    uint32_to_string(allocation_count, buffer);
+    uint32_to_string(stats.active_allocations, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" (");
+    uint32_to_string(stats.alloc_count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" allocs, ");
+    uint32_to_string(stats.free_count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" frees)\n");
+    
+    terminal_writestring("  Arenas: ");
+    uint32_to_string(heap_arena_count, buffer);
     terminal_writestring(buffer);
     terminal_writestring("\n");
     
+    terminal_writestring("\nFREE BLOCK SIZES:\n");
+    for (int i = 0; i < MEMORY_HISTOGRAM_BUCKETS; i++) {
+        if (!stats.free_histogram[i]) {
+            continue;
+        }
+        size_t bucket_size = (size_t)1 << (i + MEMORY_HISTOGRAM_MIN_SHIFT);
+        terminal_writestring("  >= ");
+        if (bucket_size >= 1024) {
+            uint32_to_string(bucket_size / 1024, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring("KB: ");
+        } else {
+            uint32_to_string(bucket_size, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring("B: ");
+        }
+        uint32_to_string(stats.free_histogram[i], buffer);
+        terminal_writestring(buffer);
+        terminal_writestring("\n");
+    }
+    
+    // Large allocations are whole buddy blocks that are not heap arenas
+    size_t arena_bytes = 0;
+    for (int i = 0; i < heap_arena_count; i++) {
+        arena_bytes += heap_arenas[i].size;
+    }
+    size_t large_allocated = stats.total_bytes - arena_bytes;
+    for (int i = 0; i < zone_count; i++) {
+        large_allocated -= zones[i].free_pages * BUDDY_PAGE_SIZE;
+    }
+    
+    terminal_writestring("\nLARGE ALLOCATIONS (BUDDY):\n");
+    terminal_writestring("  Allocated: ");
+    uint32_to_string(large_allocated, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" bytes\n");
+    for (int i = 0; i < zone_count; i++) {
+        terminal_writestring("  Zone ");
+        uint32_to_string(i, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring(i == 0 ? " (static pool):\n" : " (physical memory):\n");
+        buddy_print_stats(&zones[i]);
+    }
+    
     // Kernel memory usage (actual values)
     terminal_writestring("\nKERNEL MEMORY:\n");
     
@@ -263,13 +1142,13 @@ void memory_print_stats(void) {
         terminal_writestring(" frames)\n");
     }
     
-    terminal_writestring("  Heap Pool: ");
-    uint32_to_string(MEMORY_POOL_SIZE, buffer);
+    terminal_writestring("  Heap: ");
+    uint32_to_string(stats.total_bytes, buffer);
     terminal_writestring(buffer);
     terminal_writestring(" bytes\n");
     
     // Calculate total used with actual measured values
-    uint32_t total_used = kernel_size + stack_used + total_allocated;
+    uint32_t total_used = kernel_size + stack_used + stats.allocated_bytes;
     terminal_writestring("\nTOTAL SYSTEM MEMORY:\n");
     terminal_writestring("  Used: ");
     uint32_to_string(total_used, buffer);
@@ -277,27 +1156,193 @@ void memory_print_stats(void) {
     terminal_writestring(" bytes\n");
     
     terminal_writestring("  Available for allocation: ");
-    uint32_to_string(total_free, buffer);
+    uint32_to_string(stats.free_bytes, buffer);
     terminal_writestring(buffer);
     terminal_writestring(" bytes\n");
     
-    // Show memory blocks
-    terminal_writestring("\nHEAP BLOCKS:\n");
-    memory_block_t* current = memory_list;
-    int block_count = 0;
+    // Show the non-empty free lists
+    terminal_writestring("\nFREE LISTS:\n");
+    int list_count = 0;
     
-    while (current != NULL && block_count < 10) { // Limit output
-        terminal_writestring("  Block ");
-        uint32_to_string(block_count, buffer);
+    for (int fl = 0; fl < MEMORY_FL_INDEX_COUNT && list_count < 10; fl++) { // Limit output
+        if (!(fl_bitmap & (1U << fl))) {
+            continue;
+        }
+        for (int sl = 0; sl < MEMORY_SL_INDEX_COUNT && list_count < 10; sl++) {
+            if (!(sl_bitmap[fl] & (1U << sl))) {
+                continue;
+            }
+            
+            size_t list_blocks = 0;
+            size_t list_bytes = 0;
+            for (memory_block_t* block = free_lists[fl][sl]; block; block = block->next_free) {
+                list_blocks++;
+                list_bytes += block_size(block);
+            }
+            
+            terminal_writestring("  Class ");
+            uint32_to_string(fl, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring("/");
+            uint32_to_string(sl, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring(": ");
+            uint32_to_string(list_blocks, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring(" blocks, ");
+            uint32_to_string(list_bytes, buffer);
+            terminal_writestring(buffer);
+            terminal_writestring(" bytes\n");
+            
+            list_count++;
+        }
+    }
+}
+
+#if MEMORY_PROFILE
+static uint32_t memory_profile_key(const memory_site_t* site, memory_profile_sort_t sort) {
+    switch (sort) {
+        case MEMORY_PROFILE_BY_COUNT:
+            return site->alloc_count;
+        case MEMORY_PROFILE_BY_CHURN:
+            return site->free_count;
+        default:
+            return (uint32_t)site->live_bytes;
+    }
+}
+#endif
+
+void memory_profile_print(memory_profile_sort_t sort, int limit) {
+#if MEMORY_PROFILE
+    terminal_writestring("Caller        Live    Peak   Allocs  Frees  Sizes\n");
+    
+    // Selection of the top sites without reordering the hash table
+    uint8_t printed[MEMORY_PROFILE_SITES];
+    memset(printed, 0, sizeof(printed));
+    char buffer[32];
+    int shown = 0;
+    
+    while (shown < limit) {
+        int best = -1;
+        for (int i = 0; i < MEMORY_PROFILE_SITES; i++) {
+            if (!profile_sites[i].caller || printed[i]) {
+                continue;
+            }
+            if (best < 0 || memory_profile_key(&profile_sites[i], sort) >
+                            memory_profile_key(&profile_sites[best], sort)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        printed[best] = 1;
+        
+        memory_site_t* site = &profile_sites[best];
+        terminal_writestring("0x");
+        uint32_to_hex((uint32_t)(uintptr_t)site->caller, buffer);
+        terminal_writestring(buffer);
+        for (int pad = strlen(buffer); pad < 8; pad++) {
+            terminal_writestring(" ");
+        }
+        uint32_to_string_padded(site->live_bytes, buffer, 8, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(site->peak_bytes, buffer, 8, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(site->alloc_count, buffer, 9, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(site->free_count, buffer, 7, ' ');
         terminal_writestring(buffer);
-        terminal_writestring(": ");
-        uint32_to_string(current->size, buffer);
+        terminal_writestring("  ");
+        uint32_to_string(site->min_size, buffer);
+        terminal_writestring(buffer);
+        terminal_writestring("-");
+        uint32_to_string(site->max_size, buffer);
         terminal_writestring(buffer);
-        terminal_writestring(" bytes");
-        terminal_writestring(current->is_free ? " (FREE)" : " (USED)");
         terminal_writestring("\n");
         
-        current = current->next;
-        block_count++;
+        shown++;
+    }
+    
+    if (shown == 0) {
+        terminal_writestring("No allocations recorded.\n");
     }
+#else
+    (void)sort;
+    (void)limit;
+    terminal_writestring("Allocation profiling is disabled. Rebuild with 'make MEMORY_PROFILE=1'.\n");
+#endif
+}
+
+#if MEMORY_TRACE
+void memory_trace_start(void) {
+    trace_head = 0;
+    trace_count = 0;
+    trace_dropped = 0;
+    trace_enabled = 1;
+}
+
+void memory_trace_stop(void) {
+    trace_enabled = 0;
+}
+
+int memory_trace_enabled(void) {
+    return trace_enabled;
+}
+
+// Bytes needed to export the current trace
+size_t memory_trace_size(void) {
+    return sizeof(memory_trace_header_t) + trace_count * sizeof(memory_trace_entry_t);
+}
+
+// Write the trace (header plus entries, oldest first) into buffer and
+// return the bytes written, or 0 if it does not fit. Stop tracing first so
+// allocating the buffer does not change the trace.
+size_t memory_trace_export(void* buffer, size_t size) {
+    if (!buffer || size < memory_trace_size()) {
+        return 0;
+    }
+    
+    memory_trace_header_t* header = (memory_trace_header_t*)buffer;
+    memcpy(header->magic, MEMORY_TRACE_MAGIC, sizeof(header->magic));
+    header->version = MEMORY_TRACE_VERSION;
+    header->count = trace_count;
+    header->dropped = trace_dropped;
+    
+    memory_trace_entry_t* entries = (memory_trace_entry_t*)(header + 1);
+    uint32_t first = (trace_head - trace_count) & (MEMORY_TRACE_ENTRIES - 1);
+    for (uint32_t i = 0; i < trace_count; i++) {
+        entries[i] = trace_ring[(first + i) & (MEMORY_TRACE_ENTRIES - 1)];
+    }
+    
+    return memory_trace_size();
+}
+#else
+void memory_trace_start(void) {
+}
+
+void memory_trace_stop(void) {
+}
+
+int memory_trace_enabled(void) {
+    return 0;
+}
+
+size_t memory_trace_size(void) {
+    return 0;
+}
+
+size_t memory_trace_export(void* buffer, size_t size) {
+    (void)buffer;
+    (void)size;
+    return 0;
+}
+#endif
+
+#ifdef MEMORY_HOSTED
+// Hosted builds (tools/heapreplay) start each replay from an empty heap
+void memory_hosted_reset(void) {
+    memory_initialized = 0;
+    memory_init();
 }
+#endif
@@ -1,8 +1,17 @@
 #include "process.h"
 #include "memory.h"
+#include "slab.h"
 #include "terminal.h"
 #include "string.h"
 #include "memory_utils.h"
+#include "frame.h"
+#include "idt.h"
+#include "shm.h"
+#include "fat16.h"
+#include "swap.h"
+#include "mouse.h"
+#include "keyboard.h"
+#include "timer.h"
 
 // Global process management data
 process_t* process_list_head = NULL;  // Made non-static for external access
@@ -10,12 +19,34 @@ process_t* current_process = NULL;  // Made non-static for external access
 static uint32_t next_pid = 1;
 static int scheduler_initialized = 0;
 
+// Arena chunk header, padded so allocations stay PROC_ARENA_ALIGN aligned
+#define PROC_ARENA_HEADER ((sizeof(proc_chunk_t) + PROC_ARENA_ALIGN - 1) & ~(PROC_ARENA_ALIGN - 1))
+
 // Time slice for round-robin scheduling (in milliseconds)
 #define TIME_SLICE_MS 100
-#define MAX_PROCESSES 64
 
-static process_t process_pool[MAX_PROCESSES];
-static int process_pool_index = 0;
+// Process control blocks come from a slab cache so terminated slots are reused
+static kmem_cache_t* process_cache = NULL;
+
+// Owners of the process window slots. A process that terminates itself is
+// still running on its slot's stack, so its release waits in exited_process
+// until some other context reaps it.
+static process_t* vm_slots[PROC_VM_SLOTS];
+static process_t* exited_process = NULL;
+
+// Sleeping processes, soonest wake_tick first. The timer IRQ pops them,
+// so the queue is only changed elsewhere with interrupts off.
+static process_t* sleep_queue = NULL;
+
+// Clock hand for swap eviction, as a page index into the process window
+#define PROC_SLOT_PAGES (PROC_VM_SLOT_SIZE / VMM_PAGE_SIZE)
+static uint32_t swap_hand = 0;
+
+// Copy-on-write faults copy through this buffer: the new frame replaces
+// the shared one at the same address, so the old contents must be saved
+static uint8_t cow_buffer[VMM_PAGE_SIZE] __attribute__((aligned(16)));
+
+static void process_page_fault(interrupt_frame_t* frame);
 
 // Initialize the process management system
 void process_init(void) {
@@ -25,9 +56,13 @@ void process_init(void) {
     
     terminal_writestring("Initializing process management...\n");
     
-    // Clear process pool
-    memset(process_pool, 0, sizeof(process_pool));
-    process_pool_index = 0;
+    // Create the process control block cache
+    if (!process_cache) {
+        process_cache = kmem_cache_create("process", sizeof(process_t), 0, NULL);
+    }
+    
+    // Process stacks and memory are backed on first touch
+    idt_register_handler(IDT_VECTOR_PAGE_FAULT, process_page_fault);
     
     scheduler_initialized = 1;
     terminal_writestring("Process management initialized\n");
@@ -38,13 +73,17 @@ uint32_t process_generate_pid(void) {
     return next_pid++;
 }
 
-// Allocate a process from the pool
+// Allocate a process control block
 static process_t* process_allocate(void) {
-    if (process_pool_index >= MAX_PROCESSES) {
+    if (!process_cache) {
+        process_cache = kmem_cache_create("process", sizeof(process_t), 0, NULL);
+    }
+    
+    process_t* proc = (process_t*)kmem_cache_alloc(process_cache);
+    if (!proc) {
         return NULL;
     }
     
-    process_t* proc = &process_pool[process_pool_index++];
     memset(proc, 0, sizeof(process_t));
     return proc;
 }
@@ -80,19 +119,443 @@ static void process_remove_from_list(process_t* proc) {
     proc->prev = NULL;
 }
 
+static uint64_t process_slot_base(uint32_t slot) {
+    return PROC_VM_BASE + (uint64_t)slot * PROC_VM_SLOT_SIZE;
+}
+
+// Claim a free slot in the process window, or -1 if all are in use
+static int process_slot_alloc(process_t* proc) {
+    for (int slot = 0; slot < PROC_VM_SLOTS; slot++) {
+        if (!vm_slots[slot]) {
+            vm_slots[slot] = proc;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Return every frame faulted into a slot and every swap slot its pages
+// were written to, and drop its mappings
+static void process_slot_release(uint32_t slot) {
+    uint64_t base = process_slot_base(slot);
+    for (uint64_t page = base; page < base + PROC_VM_SLOT_SIZE; page += VMM_PAGE_SIZE) {
+        uint64_t phys = vmm_translate(page);
+        if (phys) {
+            frame_free(phys);
+            continue;
+        }
+        uint64_t entry = vmm_swap_entry(page);
+        if (entry) {
+            swap_free_entry(entry);
+            vmm_set_swap_entry(page, 0);
+        }
+    }
+    vmm_unmap(base, PROC_VM_SLOT_SIZE);
+    vm_slots[slot] = NULL;
+}
+
+// Finish tearing down a process that terminated itself
+static void process_reap_exited(void) {
+    if (exited_process) {
+        process_slot_release(exited_process->vm_slot);
+        kmem_cache_free(process_cache, exited_process);
+        exited_process = NULL;
+    }
+}
+
+static void process_add_vma(process_t* proc, uint64_t start, uint64_t end, uint32_t flags) {
+    vm_area_t* vma = &proc->vmas[proc->vma_count++];
+    vma->start = start;
+    vma->end = end;
+    vma->flags = flags;
+    vma->fault = NULL;
+    vma->data = NULL;
+}
+
+static vm_area_t* process_find_vma(process_t* proc, uint64_t page) {
+    for (int i = 0; i < proc->vma_count; i++) {
+        if (page >= proc->vmas[i].start && page < proc->vmas[i].end) {
+            return &proc->vmas[i];
+        }
+    }
+    return NULL;
+}
+
+// Register a memory area whose pages are supplied by fault. The range
+// must be page aligned and not overlap an existing area.
+int process_map_area(process_t* proc, uint64_t start, uint64_t end, uint32_t flags,
+                     vm_fault_handler_t fault, void* data) {
+    if (!proc || !fault || start >= end || ((start | end) & (VMM_PAGE_SIZE - 1)) ||
+        proc->vma_count >= PROC_MAX_VMAS) {
+        return 0;
+    }
+    for (int i = 0; i < proc->vma_count; i++) {
+        if (start < proc->vmas[i].end && end > proc->vmas[i].start) {
+            return 0;
+        }
+    }
+    
+    process_add_vma(proc, start, end, flags);
+    proc->vmas[proc->vma_count - 1].fault = fault;
+    proc->vmas[proc->vma_count - 1].data = data;
+    return 1;
+}
+
+// Forget the area starting at start; its pages must already be unmapped
+void process_unmap_area(process_t* proc, uint64_t start) {
+    for (int i = 0; i < proc->vma_count; i++) {
+        if (proc->vmas[i].start == start) {
+            proc->vmas[i] = proc->vmas[--proc->vma_count];
+            return;
+        }
+    }
+}
+
+// Write to a page shared with a clone: take a private copy, or just make
+// the page writable again if every other sharer has already let go of it
+static int process_cow_fault(process_t* owner, vm_area_t* vma, uint64_t page) {
+    uint64_t shared = vmm_translate(page);
+    owner->cow_faults++;
+    
+    if (frame_ref_count(shared) == 1) {
+        return vmm_protect(page, VMM_PAGE_SIZE, vma->flags);
+    }
+    
+    uint64_t phys = frame_alloc();
+    if (!phys) {
+        return 0;
+    }
+    memcpy(cow_buffer, (void*)page, VMM_PAGE_SIZE);
+    if (!vmm_map(page, phys, VMM_PAGE_SIZE, vma->flags)) {
+        frame_free(phys);
+        return 0;
+    }
+    memcpy((void*)page, cow_buffer, VMM_PAGE_SIZE);
+    frame_free(shared);
+    return 1;
+}
+
+// Page faults in process memory areas: back anonymous pages with zeroed
+// frames, copy shared pages on write, hand other areas to their fault
+// handler, and kill a process that runs off the end of its stack
+static void process_page_fault(interrupt_frame_t* frame) {
+    uint64_t address;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(address));
+    
+    uint64_t page = address & ~(VMM_PAGE_SIZE - 1);
+    uint64_t window_end = PROC_VM_BASE + (uint64_t)PROC_VM_SLOTS * PROC_VM_SLOT_SIZE;
+    process_t* owner = NULL;
+    int slot = -1;
+    
+    if (address >= PROC_VM_BASE && address < window_end) {
+        slot = (address - PROC_VM_BASE) / PROC_VM_SLOT_SIZE;
+        owner = vm_slots[slot];
+        if (!owner) {
+            idt_panic(frame, "Page fault in unused process slot");
+        }
+    } else if (address >= VMM_USER_BASE && address < VMM_USER_TOP) {
+        // The user half belongs to whichever process is running
+        owner = current_process;
+    }
+    if (!owner) {
+        idt_panic(frame, "Page fault");
+    }
+    
+    vm_area_t* vma = process_find_vma(owner, page);
+    if (vma && vma->fault) {
+        if (!vma->fault(owner, vma, page, frame->error_code)) {
+            idt_panic(frame, "Failed to page in mapped memory");
+        }
+        return;
+    }
+    
+    if (vma && slot >= 0) {
+        if (frame->error_code & PAGE_FAULT_PRESENT) {
+            if (!(frame->error_code & PAGE_FAULT_WRITE) || !(vma->flags & VMM_MAP_WRITE)) {
+                idt_panic(frame, "Protection fault in process memory");
+            }
+            if (!process_cow_fault(owner, vma, page)) {
+                idt_panic(frame, "Out of memory copying shared process page");
+            }
+            return;
+        }
+        
+        uint64_t entry = vmm_swap_entry(page);
+        if (entry) {
+            // The mapping replaces the entry, which the page table cannot
+            // fail to hold, then the page is read back through it
+            uint64_t phys = frame_alloc();
+            if (!phys || !vmm_map(page, phys, VMM_PAGE_SIZE, vma->flags)) {
+                idt_panic(frame, "Out of memory swapping in process page");
+            }
+            if (!swap_read_page(entry, (void*)page)) {
+                idt_panic(frame, "Failed to read swapped process page");
+            }
+            owner->swapped_pages--;
+            owner->resident_pages++;
+            return;
+        }
+        
+        uint64_t phys = frame_alloc_zeroed();
+        if (!phys) {
+            idt_panic(frame, "Out of memory backing process page");
+        }
+        if (!vmm_map(page, phys, VMM_PAGE_SIZE, vma->flags)) {
+            frame_free(phys);
+            idt_panic(frame, "Failed to map process page");
+        }
+        owner->resident_pages++;
+        return;
+    }
+    
+    if (slot >= 0 && owner == current_process && page == process_slot_base(slot)) {
+        // The fault runs on its own IST stack, so the process can be
+        // terminated from here; it is never resumed.
+        terminal_writestring("Stack overflow in process ");
+        terminal_writestring(owner->name);
+        terminal_writestring("\n");
+        process_terminate(owner, -1);
+    }
+    
+    idt_panic(frame, "Page fault outside process regions");
+}
+
+// A page written to swap whose frame is held until the disk flush
+typedef struct {
+    process_t* owner;
+    uint64_t page;
+    uint64_t phys;
+    uint64_t entry;
+    uint32_t flags;
+} swap_evicted_t;
+
+// Write one page out if it is anonymous, private and not used since the
+// hand last passed it, leaving a swap entry in its place. Returns 1 if it
+// was written, 0 if the page was skipped and -1 if swap is full.
+static int process_swap_page(process_t* owner, uint64_t page, swap_evicted_t* evicted) {
+    vm_area_t* vma = process_find_vma(owner, page);
+    if (!vma || vma->fault) {
+        return 0;
+    }
+    // The running stack would change between the copy and the unmap
+    if (owner == current_process && vma->start == (uint64_t)owner->stack_base) {
+        return 0;
+    }
+    uint64_t phys = vmm_translate(page);
+    if (!phys || frame_ref_count(phys) > 1 || vmm_test_accessed(page)) {
+        return 0;
+    }
+    
+    uint64_t entry = swap_write_page((void*)page);
+    if (!entry) {
+        return -1;
+    }
+    vmm_set_swap_entry(page, entry);
+    evicted->owner = owner;
+    evicted->page = page;
+    evicted->phys = phys;
+    evicted->entry = entry;
+    evicted->flags = vma->flags;
+    return 1;
+}
+
+// Flush the swap disk's write cache, then free the frames written before
+// it. If the flush fails the pages are mapped back, since the drive may
+// not hold the only copy. Returns the number of frames freed.
+static size_t process_swap_commit(swap_evicted_t* evicted, size_t count) {
+    int synced = swap_sync();
+    for (size_t i = 0; i < count; i++) {
+        if (synced) {
+            frame_free(evicted[i].phys);
+            evicted[i].owner->resident_pages--;
+            evicted[i].owner->swapped_pages++;
+        } else {
+            vmm_map(evicted[i].page, evicted[i].phys, VMM_PAGE_SIZE, evicted[i].flags);
+            swap_free_entry(evicted[i].entry);
+        }
+    }
+    return synced ? count : 0;
+}
+
+// Clock eviction over the process window. Pages are aged by their
+// accessed bit: the hand clears it on one pass and evicts the page if it
+// is still clear the next time round, so at most two sweeps are needed.
+// Process pages live in the shared kernel window, so eviction works the
+// same whichever process is running.
+size_t process_swap_out(size_t count) {
+    if (!swap_enabled()) {
+        return 0;
+    }
+    
+    const uint32_t window_pages = PROC_VM_SLOTS * PROC_SLOT_PAGES;
+    swap_evicted_t evicted[SWAP_EVICT_BATCH];
+    size_t pending = 0;
+    size_t freed = 0;
+    uint32_t scanned = 0;
+    while (freed + pending < count && scanned < 2 * window_pages) {
+        uint32_t slot = swap_hand / PROC_SLOT_PAGES;
+        process_t* owner = vm_slots[slot];
+        if (!owner) {
+            // Skip the rest of an unused slot at once
+            uint32_t next = (slot + 1) * PROC_SLOT_PAGES;
+            scanned += next - swap_hand;
+            swap_hand = next % window_pages;
+            continue;
+        }
+        
+        uint64_t page = PROC_VM_BASE + (uint64_t)swap_hand * VMM_PAGE_SIZE;
+        swap_hand = (swap_hand + 1) % window_pages;
+        scanned++;
+        int result = process_swap_page(owner, page, &evicted[pending]);
+        if (result < 0) {
+            break;
+        }
+        pending += result;
+        if (pending == SWAP_EVICT_BATCH) {
+            size_t committed = process_swap_commit(evicted, pending);
+            pending = 0;
+            if (!committed) {
+                return freed;
+            }
+            freed += committed;
+        }
+    }
+    if (pending > 0) {
+        freed += process_swap_commit(evicted, pending);
+    }
+    return freed;
+}
+
+// Take a terminating process off the sleep queue. This can run from the
+// page fault handler, so the interrupt flag is restored, not just set.
+static void process_sleep_cancel(process_t* proc) {
+    uint64_t flags;
+    __asm__ volatile("pushfq; pop %0; cli" : "=r"(flags) : : "memory");
+    for (process_t** link = &sleep_queue; *link; link = &(*link)->sleep_next) {
+        if (*link == proc) {
+            *link = proc->sleep_next;
+            proc->sleep_next = NULL;
+            break;
+        }
+    }
+    __asm__ volatile("push %0; popfq" : : "r"(flags) : "memory", "cc");
+}
+
 // Trampoline for process exit
 static void process_exit_trampoline(void) {
     process_terminate(current_process, 0);
     while(1); // Should not be reached
 }
 
-// Create a new process
-process_t* process_create(const char* name, process_entry_t entry, void* args,
-                         process_priority_t priority, size_t stack_size) {
+// Free every spill chunk, leaving only the process memory region
+static void process_arena_release(process_t* proc) {
+    proc_chunk_t* chunk = proc->arena_chunk;
+    while (chunk && chunk != (proc_chunk_t*)proc->memory_base) {
+        proc_chunk_t* next = chunk->next;
+        kfree(chunk);
+        chunk = next;
+    }
+    proc->arena_chunk = chunk;
+    proc->arena_offset = PROC_ARENA_HEADER;
+}
+
+// Bump-allocate from the current process's arena. Nothing is freed
+// individually: proc_reset or process exit releases the whole arena.
+void* proc_alloc(size_t size) {
+    process_t* proc = current_process;
+    if (!proc || !proc->arena_chunk || size == 0) {
+        return NULL;
+    }
+    
+    size = (size + PROC_ARENA_ALIGN - 1) & ~(size_t)(PROC_ARENA_ALIGN - 1);
+    
+    if (proc->arena_offset + size > proc->arena_chunk->size) {
+        // Chunk full - chain a new one in front of it
+        size_t chunk_size = PROC_ARENA_HEADER + size;
+        if (chunk_size < PROC_ARENA_CHUNK_SIZE) {
+            chunk_size = PROC_ARENA_CHUNK_SIZE;
+        }
+        
+        proc_chunk_t* chunk = (proc_chunk_t*)kmalloc(chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = proc->arena_chunk;
+        chunk->size = chunk_size;
+        proc->arena_chunk = chunk;
+        proc->arena_offset = PROC_ARENA_HEADER;
+    }
+    
+    void* ptr = (char*)proc->arena_chunk + proc->arena_offset;
+    proc->arena_offset += size;
+    return ptr;
+}
+
+// Drop everything allocated from the current process's arena
+void proc_reset(void) {
+    if (current_process && current_process->arena_chunk) {
+        process_arena_release(current_process);
+    }
+}
+
+// Share source's resident process memory pages with proc, read-only on
+// both sides until one of them writes. Pages source never touched fault
+// in zeroed on either side as usual.
+static void process_share_memory(process_t* source, process_t* proc) {
+    uint64_t from = (uint64_t)source->memory_base;
+    uint64_t to = (uint64_t)proc->memory_base;
+    
+    for (uint64_t offset = 0; offset < PROC_MEMORY_SIZE; offset += VMM_PAGE_SIZE) {
+        if (vmm_swap_entry(from + offset)) {
+            // Fault the page back in so there is a frame to share
+            (void)*(volatile uint8_t*)(from + offset);
+        }
+        uint64_t phys = vmm_translate(from + offset);
+        if (!phys) {
+            continue;
+        }
+        
+        if (frame_share(phys)) {
+            if (vmm_protect(from + offset, VMM_PAGE_SIZE, VMM_MAP_NOEXEC) &&
+                vmm_map(to + offset, phys, VMM_PAGE_SIZE, VMM_MAP_NOEXEC)) {
+                proc->resident_pages++;
+                proc->cow_shared++;
+                continue;
+            }
+            frame_free(phys);
+        }
+        
+        // Share table full or mapping failed: copy now, faulting the
+        // child's page in
+        memcpy((void*)(to + offset), (void*)(from + offset), VMM_PAGE_SIZE);
+    }
+    
+    // The first chunk header came across with the memory. If source has
+    // spilled, its first chunk is full.
+    proc->arena_chunk = (proc_chunk_t*)proc->memory_base;
+    if (source->arena_chunk == (proc_chunk_t*)source->memory_base) {
+        proc->arena_offset = source->arena_offset;
+    } else {
+        proc->arena_offset = proc->memory_size;
+    }
+}
+
+// Create a process, starting its memory as a copy-on-write copy of
+// source's if source is not NULL
+static process_t* process_setup(const char* name, process_entry_t entry, void* args,
+                                process_priority_t priority, size_t stack_size,
+                                process_t* source) {
     if (!scheduler_initialized && strcmp(name, "kernel") != 0) {
         return NULL;
     }
     
+    if (stack_size == 0 || stack_size > PROC_STACK_MAX) {
+        terminal_writestring("ERROR: Process stack size out of range\n");
+        return NULL;
+    }
+    
+    process_reap_exited();
+    
     // Allocate process structure
     process_t* proc = process_allocate();
     if (!proc) {
@@ -110,31 +573,55 @@ process_t* process_create(const char* name, process_entry_t entry, void* args,
     proc->time_used = 0;
     proc->total_time = 0;
     proc->exit_code = 0;
-    proc->parent = current_process;
+    proc->parent = source ? source : current_process;
     
-    // Allocate stack
-    proc->stack_size = stack_size;
-    proc->stack_base = kmalloc(stack_size);
-    if (!proc->stack_base) {
-        terminal_writestring("ERROR: Failed to allocate process stack\n");
+    // Reserve the stack and process memory; frames are faulted in on first
+    // touch, and the page below the stack stays unmapped as a guard
+    int slot = process_slot_alloc(proc);
+    if (slot < 0) {
+        terminal_writestring("ERROR: No free process memory slots\n");
+        kmem_cache_free(process_cache, proc);
         return NULL;
     }
+    proc->vm_slot = slot;
+    
+    uint64_t slot_base = process_slot_base(slot);
+    uint64_t stack_start = slot_base + PROC_GUARD_SIZE;
+    uint64_t stack_end = stack_start + ((stack_size + VMM_PAGE_SIZE - 1) & ~(VMM_PAGE_SIZE - 1));
+    proc->stack_size = stack_size;
+    proc->stack_base = (void*)stack_start;
+    process_add_vma(proc, stack_start, stack_end, VMM_MAP_WRITE | VMM_MAP_NOEXEC);
     
-    // Allocate process memory (simple linear allocation for now)
-    proc->memory_size = 64 * 1024; // 64KB per process
-    proc->memory_base = kmalloc(proc->memory_size);
-    if (!proc->memory_base) {
-        terminal_writestring("ERROR: Failed to allocate process memory\n");
-        kfree(proc->stack_base);
+    // The process memory becomes the first arena chunk
+    proc->memory_size = PROC_MEMORY_SIZE;
+    proc->memory_base = (void*)(slot_base + PROC_VM_SLOT_SIZE - PROC_MEMORY_SIZE);
+    process_add_vma(proc, (uint64_t)proc->memory_base, slot_base + PROC_VM_SLOT_SIZE,
+                    VMM_MAP_WRITE | VMM_MAP_NOEXEC);
+    
+    // Each process gets its own page tables sharing the kernel mappings
+    proc->address_space = address_space_create();
+    if (!proc->address_space) {
+        terminal_writestring("ERROR: Failed to create process address space\n");
+        vm_slots[slot] = NULL;
+        kmem_cache_free(process_cache, proc);
         return NULL;
     }
     
+    if (source) {
+        process_share_memory(source, proc);
+    } else {
+        proc->arena_chunk = (proc_chunk_t*)proc->memory_base;
+        proc->arena_chunk->next = NULL;
+        proc->arena_chunk->size = proc->memory_size;
+        proc->arena_offset = PROC_ARENA_HEADER;
+    }
+    
     // Initialize CPU context
     memset(&proc->context, 0, sizeof(cpu_context_t));
     
     // Set up stack pointer (grows downward)
     // Align to 16 bytes
-    uint64_t stack_top = (uint64_t)proc->stack_base + stack_size;
+    uint64_t stack_top = stack_end;
     stack_top &= ~0xF;
     
     uint64_t* stack_ptr = (uint64_t*)stack_top;
@@ -152,12 +639,11 @@ process_t* process_create(const char* name, process_entry_t entry, void* args,
     // Set up arguments in RDI register (first argument for System V ABI)
     proc->context.rdi = (uint64_t)args;
     
-    // Set default flags (interrupts DISABLED because we have no IDT yet)
-    // 0x002 = Reserved bit (must be 1), IF=0
-    proc->context.rflags = 0x002;
+    // Set default flags: 0x002 = Reserved bit (must be 1), 0x200 = IF
+    proc->context.rflags = 0x202;
     
-    // Use kernel page directory for now (no memory isolation yet)
-    __asm__ volatile("mov %%cr3, %0" : "=r"(proc->context.cr3));
+    // Switching to this process loads its address space
+    proc->context.cr3 = proc->address_space->cr3;
     
     // Add to process list
     process_add_to_list(proc);
@@ -173,12 +659,31 @@ process_t* process_create(const char* name, process_entry_t entry, void* args,
     return proc;
 }
 
+// Create a new process
+process_t* process_create(const char* name, process_entry_t entry, void* args,
+                         process_priority_t priority, size_t stack_size) {
+    return process_setup(name, entry, args, priority, stack_size, NULL);
+}
+
+// Create a process running entry(args) whose process memory starts as a
+// copy of parent's. Pages are shared read-only and copied on the first
+// write from either side. The child gets a fresh stack, and its copy sits
+// at its own memory_base, so pointers into parent's memory are not rebased.
+process_t* process_clone(process_t* parent, const char* name, process_entry_t entry, void* args) {
+    if (!parent || !parent->memory_base) {
+        return NULL;
+    }
+    return process_setup(name, entry, args, parent->priority, parent->stack_size, parent);
+}
+
 // Terminate a process
 void process_terminate(process_t* proc, int exit_code) {
     if (!proc) {
         return;
     }
     
+    process_reap_exited();
+    
     terminal_writestring("Terminating process: ");
     terminal_writestring(proc->name);
     terminal_writestring(" (PID: ");
@@ -190,15 +695,20 @@ void process_terminate(process_t* proc, int exit_code) {
     proc->state = PROCESS_STATE_TERMINATED;
     proc->exit_code = exit_code;
     
-    // Free memory
-    if (proc->stack_base) {
-        kfree(proc->stack_base);
-        proc->stack_base = NULL;
+    // Free spill chunks; the process window slot is released below
+    if (proc->memory_base) {
+        process_arena_release(proc);
     }
     
-    if (proc->memory_base) {
-        kfree(proc->memory_base);
-        proc->memory_base = NULL;
+    // File and shared memory mappings live in the address space
+    fat16_munmap_process(proc);
+    shm_release_process(proc);
+    keyboard_release_process(proc);
+    process_sleep_cancel(proc);
+    
+    if (proc->address_space) {
+        address_space_release(proc->address_space);
+        proc->address_space = NULL;
     }
     
     // Remove from process list
@@ -213,12 +723,17 @@ void process_terminate(process_t* proc, int exit_code) {
             current_process = NULL;
             __asm__ volatile("cli; hlt"); // Halt the system
         } else {
+            // Still running on this process's stack: release it later
             current_process = NULL;
+            exited_process = proc;
             // Only schedule if there are other processes to run
             if (process_list_head) {
                 process_schedule();
             }
         }
+    } else {
+        process_slot_release(proc->vm_slot);
+        kmem_cache_free(process_cache, proc);
     }
 }
 
@@ -253,8 +768,8 @@ void process_list(void) {
         return;
     }
     
-    terminal_writestring("PID\tName\t\tState\t\tPriority\tMemory\n");
-    terminal_writestring("---\t----\t\t-----\t\t--------\t------\n");
+    terminal_writestring("PID\tName\t\tState\t\tPriority\tMemory\t\tCOW faults/shared\tSwapped\n");
+    terminal_writestring("---\t----\t\t-----\t\t--------\t------\t\t-----------------\n");
     
     process_t* proc = process_list_head;
     do {
@@ -302,9 +817,22 @@ void process_list(void) {
                 break;
         }
         
-        // Memory usage
+        // Resident memory: stack and process pages faulted in so far
         char mem_str[16];
-        uint32_to_string(proc->memory_size, mem_str);
+        uint32_to_string(proc->resident_pages * VMM_PAGE_SIZE, mem_str);
+        terminal_writestring(mem_str);
+        terminal_writestring(" bytes\t");
+        
+        // Copy-on-write: write faults taken against pages shared at clone
+        uint32_to_string(proc->cow_faults, mem_str);
+        terminal_writestring(mem_str);
+        terminal_writestring("/");
+        uint32_to_string(proc->cow_shared, mem_str);
+        terminal_writestring(mem_str);
+        terminal_writestring("\t\t\t");
+        
+        // Pages written out to swap
+        uint32_to_string(proc->swapped_pages * VMM_PAGE_SIZE, mem_str);
         terminal_writestring(mem_str);
         terminal_writestring(" bytes\n");
         
@@ -350,11 +878,18 @@ void process_schedule(void) {
         return;
     }
     
+    // Safe once we are off the exited process's stack
+    if (current_process) {
+        process_reap_exited();
+    }
+    
     process_t* next_proc = process_find_next();
     if (!next_proc) {
-        // No ready processes, run kernel process or halt
-        if (current_process && current_process->priority == PROCESS_PRIORITY_KERNEL) {
-            return; // Already running kernel process
+        // No ready processes: keep running the current one if it can
+        // (the idle loop yields every pass), else run kernel process or halt
+        if (current_process && (current_process->priority == PROCESS_PRIORITY_KERNEL ||
+                                current_process->state == PROCESS_STATE_RUNNING)) {
+            return;
         }
         
         // Find kernel process
@@ -369,6 +904,9 @@ void process_schedule(void) {
         } while (kernel_proc != process_list_head);
         
         if (!next_proc) {
+            if (current_process && current_process->state == PROCESS_STATE_BLOCKED) {
+                return; // The caller waits for its own wakeup
+            }
             terminal_writestring("No processes available, halting...\n");
             __asm__ volatile("hlt");
             return;
@@ -399,12 +937,57 @@ void process_yield(void) {
     process_schedule();
 }
 
-// Sleep for specified milliseconds (simplified - no real timer)
+// Block the current process for at least the given time. Interrupts stay
+// off from queueing until the switch so the wakeup cannot come first.
 void process_sleep(uint64_t milliseconds) {
-    (void)milliseconds; // Ignore for now
-    if (current_process) {
-        current_process->state = PROCESS_STATE_BLOCKED;
-        process_schedule();
+    uint64_t ticks = (milliseconds * TIMER_HZ + 999) / 1000;
+    if (ticks == 0) {
+        process_yield();
+        return;
+    }
+    
+    __asm__ volatile("cli");
+    uint64_t wake = timer_ticks() + ticks;
+    process_t* proc = current_process;
+    if (!proc) {
+        // Nothing to switch to yet: wait for the ticks right here
+        while (timer_ticks() < wake) {
+            __asm__ volatile("sti; hlt; cli");
+        }
+        __asm__ volatile("sti");
+        return;
+    }
+    
+    // After any sleeper due at the same tick, so equal sleeps wake in order
+    process_t** link = &sleep_queue;
+    while (*link && (*link)->wake_tick <= wake) {
+        link = &(*link)->sleep_next;
+    }
+    proc->wake_tick = wake;
+    proc->sleep_next = *link;
+    *link = proc;
+    
+    proc->state = PROCESS_STATE_BLOCKED;
+    process_schedule();
+    
+    // With every process asleep and no idle process to switch to, the
+    // schedule comes straight back: wait out the sleep here instead
+    while (proc->state == PROCESS_STATE_BLOCKED) {
+        __asm__ volatile("sti; hlt; cli");
+    }
+    proc->state = PROCESS_STATE_RUNNING;
+    __asm__ volatile("sti");
+}
+
+// Ready every sleeper whose time has come; called from the timer IRQ
+void process_wake_sleepers(uint64_t now) {
+    while (sleep_queue && sleep_queue->wake_tick <= now) {
+        process_t* proc = sleep_queue;
+        sleep_queue = proc->sleep_next;
+        proc->sleep_next = NULL;
+        if (proc->state == PROCESS_STATE_BLOCKED) {
+            proc->state = PROCESS_STATE_READY;
+        }
     }
 }
 
@@ -430,15 +1013,28 @@ void kernel_process_main(void* args) {
         // Cleanup terminated processes
         process_cleanup_terminated();
         
-        // Simple delay to prevent busy waiting
-        for (volatile int i = 0; i < 10000; i++) {
-            // Busy wait
+        // Move the cursor for mouse input that arrived while idle
+        mouse_refresh();
+        
+        // Nothing else wants the CPU: clear free frames ahead of time so
+        // allocations do not have to. Once the pool is full, sleep until an
+        // interrupt; sti only takes effect after hlt, so a wakeup between
+        // the check and the halt still ends the halt.
+        if (!frame_zero_idle(FRAME_ZERO_BATCH)) {
+            __asm__ volatile("cli");
+            if (process_find_next()) {
+                __asm__ volatile("sti");
+            } else {
+                __asm__ volatile("sti; hlt");
+            }
         }
     }
 }
 
 // Clean up terminated processes
 void process_cleanup_terminated(void) {
+    process_reap_exited();
+    
     if (!process_list_head) {
         return;
     }
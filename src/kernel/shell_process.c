@@ -60,8 +60,10 @@ static void shell_execute_command(const char* input) {
             break;
     }
     
-    // Free the parsed arguments
+    // Free the parsed arguments and anything the command left in the
+    // shell's arena
     command_free_args(argc, argv);
+    proc_reset();
 }
 
 static void shell_process_handle_input(char c) {
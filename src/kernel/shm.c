@@ -0,0 +1,194 @@
+#include "shm.h"
+#include "frame.h"
+#include "memory.h"
+#include "process.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+
+// One process's mapping of an object
+typedef struct {
+    process_t* proc;
+    shm_object_t* object;
+} shm_mapping_t;
+
+static shm_object_t shm_objects[SHM_MAX_OBJECTS];
+static shm_mapping_t shm_mappings[SHM_MAX_MAPPINGS];
+
+static uint64_t shm_object_address(shm_object_t* object) {
+    return SHM_BASE + (uint64_t)(object - shm_objects) * SHM_MAX_SIZE;
+}
+
+static shm_object_t* shm_find(const char* name) {
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        if (shm_objects[i].refcount && strcmp(shm_objects[i].name, name) == 0) {
+            return &shm_objects[i];
+        }
+    }
+    return NULL;
+}
+
+static shm_mapping_t* shm_find_mapping(process_t* proc, shm_object_t* object) {
+    for (int i = 0; i < SHM_MAX_MAPPINGS; i++) {
+        if (shm_mappings[i].proc == proc && shm_mappings[i].object == object) {
+            return &shm_mappings[i];
+        }
+    }
+    return NULL;
+}
+
+static void shm_free_frames(shm_object_t* object, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        frame_free(object->frames[i]);
+    }
+    kfree(object->frames);
+    memset(object, 0, sizeof(shm_object_t));
+}
+
+// Map object into proc's address space and take a reference for it
+static void* shm_attach(process_t* proc, shm_object_t* object) {
+    uint64_t addr = shm_object_address(object);
+    if (shm_find_mapping(proc, object)) {
+        return (void*)addr;
+    }
+
+    shm_mapping_t* mapping = shm_find_mapping(NULL, NULL);
+    if (!mapping || !proc->address_space) {
+        return NULL;
+    }
+
+    size_t pages = object->size / VMM_PAGE_SIZE;
+    for (size_t i = 0; i < pages; i++) {
+        if (!vmm_space_map(proc->address_space, addr + i * VMM_PAGE_SIZE, object->frames[i],
+                           VMM_PAGE_SIZE, VMM_MAP_WRITE | VMM_MAP_NOEXEC)) {
+            vmm_space_unmap(proc->address_space, addr, i * VMM_PAGE_SIZE);
+            return NULL;
+        }
+    }
+
+    mapping->proc = proc;
+    mapping->object = object;
+    object->refcount++;
+    return (void*)addr;
+}
+
+// Unmap a mapping and free the object if it was the last one
+static void shm_detach(shm_mapping_t* mapping) {
+    shm_object_t* object = mapping->object;
+    if (mapping->proc->address_space) {
+        vmm_space_unmap(mapping->proc->address_space, shm_object_address(object), object->size);
+    }
+    mapping->proc = NULL;
+    mapping->object = NULL;
+
+    if (--object->refcount == 0) {
+        shm_free_frames(object, object->size / VMM_PAGE_SIZE);
+    }
+}
+
+void* shm_create(const char* name, size_t size) {
+    process_t* proc = current_process;
+    if (!proc || !name || strlen(name) == 0 || strlen(name) >= SHM_NAME_MAX ||
+        size == 0 || size > SHM_MAX_SIZE || shm_find(name)) {
+        return NULL;
+    }
+
+    shm_object_t* object = NULL;
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        if (!shm_objects[i].refcount && !shm_objects[i].frames) {
+            object = &shm_objects[i];
+            break;
+        }
+    }
+    if (!object) {
+        return NULL;
+    }
+
+    size = (size + VMM_PAGE_SIZE - 1) & ~(VMM_PAGE_SIZE - 1);
+    size_t pages = size / VMM_PAGE_SIZE;
+    object->frames = (uint64_t*)kmalloc(pages * sizeof(uint64_t));
+    if (!object->frames) {
+        return NULL;
+    }
+    for (size_t i = 0; i < pages; i++) {
+        object->frames[i] = frame_alloc_zeroed();
+        if (!object->frames[i]) {
+            shm_free_frames(object, i);
+            return NULL;
+        }
+    }
+    strncpy(object->name, name, SHM_NAME_MAX - 1);
+    object->name[SHM_NAME_MAX - 1] = '\0';
+    object->size = size;
+
+    void* addr = shm_attach(proc, object);
+    if (!addr) {
+        shm_free_frames(object, pages);
+    }
+    return addr;
+}
+
+void* shm_map(const char* name) {
+    shm_object_t* object = name ? shm_find(name) : NULL;
+    if (!current_process || !object) {
+        return NULL;
+    }
+    return shm_attach(current_process, object);
+}
+
+int shm_unmap(void* addr) {
+    for (int i = 0; i < SHM_MAX_MAPPINGS; i++) {
+        shm_mapping_t* mapping = &shm_mappings[i];
+        if (mapping->proc && mapping->proc == current_process &&
+            shm_object_address(mapping->object) == (uint64_t)addr) {
+            shm_detach(mapping);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void shm_release_process(process_t* proc) {
+    for (int i = 0; i < SHM_MAX_MAPPINGS; i++) {
+        if (shm_mappings[i].proc == proc) {
+            shm_detach(&shm_mappings[i]);
+        }
+    }
+}
+
+void shm_list(void) {
+    terminal_writestring("=== Shared Memory ===\n");
+
+    int count = 0;
+    char buffer[32];
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        shm_object_t* object = &shm_objects[i];
+        if (!object->refcount) {
+            continue;
+        }
+        if (count++ == 0) {
+            terminal_writestring("Name\t\t\tSize\t\tMapped by\n");
+        }
+
+        terminal_writestring(object->name);
+        for (int pad = strlen(object->name); pad < 24; pad++) {
+            terminal_writestring(" ");
+        }
+        uint32_to_string((uint32_t)(object->size / 1024), buffer);
+        terminal_writestring(buffer);
+        terminal_writestring(" KB\t\t");
+
+        for (int j = 0; j < SHM_MAX_MAPPINGS; j++) {
+            if (shm_mappings[j].object == object) {
+                uint32_to_string(shm_mappings[j].proc->pid, buffer);
+                terminal_writestring(buffer);
+                terminal_writestring(" ");
+            }
+        }
+        terminal_writestring("\n");
+    }
+
+    if (count == 0) {
+        terminal_writestring("No shared memory objects.\n");
+    }
+}
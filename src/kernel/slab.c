@@ -0,0 +1,186 @@
+#include "slab.h"
+#include "memory.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+
+// Cache descriptors come from a static pool so creating a cache never
+// depends on the heap state
+static kmem_cache_t cache_pool[KMEM_MAX_CACHES];
+
+static inline size_t kmem_align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+static inline void** kmem_link(kmem_cache_t* cache, void* obj) {
+    return (void**)((char*)obj + cache->link_offset);
+}
+
+// Slab size for a cache: one default slab, or the smallest power of two
+// that fits a handful of large objects (slabs are whole buddy blocks)
+static size_t kmem_slab_bytes(kmem_cache_t* cache) {
+    size_t header = kmem_align_up(sizeof(kmem_slab_t), cache->align);
+    size_t bytes = KMEM_SLAB_SIZE;
+    while (bytes < header + cache->slot_size * KMEM_MIN_OBJECTS) {
+        bytes <<= 1;
+    }
+    return bytes;
+}
+
+kmem_cache_t* kmem_cache_create(const char* name, size_t size, size_t align, kmem_ctor_t ctor) {
+    if (!name || size == 0) {
+        return NULL;
+    }
+
+    if (align < KMEM_MIN_ALIGN) {
+        align = KMEM_MIN_ALIGN;
+    }
+    if (align & (align - 1)) {
+        return NULL; // Alignment must be a power of two
+    }
+
+    kmem_cache_t* cache = NULL;
+    for (int i = 0; i < KMEM_MAX_CACHES; i++) {
+        if (!cache_pool[i].in_use) {
+            cache = &cache_pool[i];
+            break;
+        }
+    }
+    if (!cache) {
+        terminal_writestring("ERROR: No free slab cache descriptors\n");
+        return NULL;
+    }
+
+    memset(cache, 0, sizeof(kmem_cache_t));
+    strncpy(cache->name, name, sizeof(cache->name) - 1);
+    cache->name[sizeof(cache->name) - 1] = '\0';
+    cache->object_size = size;
+    cache->align = align;
+    cache->ctor = ctor;
+
+    // Free objects are linked through their first word. Constructed
+    // objects must keep their state while free, so with a constructor the
+    // link goes in an extra word after the object instead.
+    if (ctor) {
+        cache->link_offset = kmem_align_up(size, sizeof(void*));
+        cache->slot_size = kmem_align_up(cache->link_offset + sizeof(void*), align);
+    } else {
+        cache->link_offset = 0;
+        cache->slot_size = kmem_align_up(size < sizeof(void*) ? sizeof(void*) : size, align);
+    }
+
+    size_t header = kmem_align_up(sizeof(kmem_slab_t), align);
+    cache->objects_per_slab = (kmem_slab_bytes(cache) - header) / cache->slot_size;
+    cache->in_use = 1;
+
+    return cache;
+}
+
+void kmem_cache_destroy(kmem_cache_t* cache) {
+    if (!cache || !cache->in_use) {
+        return;
+    }
+
+    kmem_slab_t* slab = cache->slabs;
+    while (slab) {
+        kmem_slab_t* next = slab->next;
+        kfree_aligned(slab);
+        slab = next;
+    }
+
+    memset(cache, 0, sizeof(kmem_cache_t));
+}
+
+// Carve a fresh slab into objects and push them onto the free list
+static int kmem_cache_grow(kmem_cache_t* cache) {
+    kmem_slab_t* slab = (kmem_slab_t*)kmalloc_aligned(kmem_slab_bytes(cache), MEMORY_PAGE_SIZE);
+    if (!slab) {
+        return 0;
+    }
+
+    slab->next = cache->slabs;
+    cache->slabs = slab;
+
+    uintptr_t first = kmem_align_up((uintptr_t)slab + sizeof(kmem_slab_t), cache->align);
+    for (size_t i = 0; i < cache->objects_per_slab; i++) {
+        void* obj = (void*)(first + i * cache->slot_size);
+        if (cache->ctor) {
+            cache->ctor(obj);
+        }
+        *kmem_link(cache, obj) = cache->free_list;
+        cache->free_list = obj;
+    }
+
+    cache->slab_count++;
+    cache->objects_total += cache->objects_per_slab;
+    return 1;
+}
+
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    if (!cache || !cache->in_use) {
+        return NULL;
+    }
+
+    if (!cache->free_list && !kmem_cache_grow(cache)) {
+        return NULL;
+    }
+
+    void* obj = cache->free_list;
+    cache->free_list = *kmem_link(cache, obj);
+
+    cache->objects_in_use++;
+    cache->alloc_count++;
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t* cache, void* obj) {
+    if (!cache || !obj) {
+        return;
+    }
+
+    *kmem_link(cache, obj) = cache->free_list;
+    cache->free_list = obj;
+
+    cache->objects_in_use--;
+    cache->free_count++;
+}
+
+void kmem_cache_print_stats(void) {
+    terminal_writestring("=== Slab Caches ===\n");
+    terminal_writestring("Name            Size  Slabs  Objs   Used   Allocs  Frees\n");
+
+    char buffer[32];
+    int cache_count = 0;
+
+    for (int i = 0; i < KMEM_MAX_CACHES; i++) {
+        kmem_cache_t* cache = &cache_pool[i];
+        if (!cache->in_use) {
+            continue;
+        }
+
+        terminal_writestring(cache->name);
+        for (int pad = strlen(cache->name); pad < 16; pad++) {
+            terminal_writestring(" ");
+        }
+
+        uint32_to_string_padded(cache->object_size, buffer, 4, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(cache->slab_count, buffer, 7, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(cache->objects_total, buffer, 6, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(cache->objects_in_use, buffer, 7, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(cache->alloc_count, buffer, 9, ' ');
+        terminal_writestring(buffer);
+        uint32_to_string_padded(cache->free_count, buffer, 7, ' ');
+        terminal_writestring(buffer);
+        terminal_writestring("\n");
+
+        cache_count++;
+    }
+
+    if (cache_count == 0) {
+        terminal_writestring("No slab caches created.\n");
+    }
+}
@@ -0,0 +1,213 @@
+#include "swap.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+#include "clock.h"
+
+// Swap entries hold slot + 1 above the present bit
+#define SWAP_ENTRY_SHIFT 1
+
+typedef struct {
+    uint32_t count;
+    uint64_t ns;                     // Total time spent on the disk
+    uint64_t max_ns;
+} swap_stat_t;
+
+// The disk is copied: ata_detect_disks rebuilds ata_disks in place
+static ata_disk_t swap_disk;
+static uint32_t swap_start_lba = 0;
+static uint32_t swap_pages = 0;      // 0 while swap is off
+static uint32_t swap_used = 0;
+static uint32_t swap_next = 0;       // Where the next free slot search starts
+static uint64_t swap_bitmap[SWAP_MAX_PAGES / 64];
+
+static swap_stat_t swap_outs;
+static swap_stat_t swap_ins;
+
+// Counts at the previous swap_print_stats, for rates since then
+static uint32_t report_outs = 0;
+static uint32_t report_ins = 0;
+static uint64_t report_ns = 0;
+
+static void swap_record(swap_stat_t* stat, uint64_t start) {
+    uint64_t ns = clock_ns() - start;
+    stat->count++;
+    stat->ns += ns;
+    if (ns > stat->max_ns) {
+        stat->max_ns = ns;
+    }
+}
+
+// Use pages slots of disk from start_lba on as swap; 0 pages takes as
+// many as fit. Everything already there is overwritten.
+int swap_on(ata_disk_t* disk, uint32_t start_lba, uint32_t pages) {
+    if (swap_pages) {
+        terminal_writestring("Swap is already enabled\n");
+        return 0;
+    }
+    if (!disk || !disk->present || start_lba >= disk->sectors) {
+        terminal_writestring("Swap area is not on the disk\n");
+        return 0;
+    }
+    
+    uint32_t available = (disk->sectors - start_lba) / SWAP_SECTORS_PER_PAGE;
+    if (pages == 0 || pages > available) {
+        pages = available;
+    }
+    if (pages > SWAP_MAX_PAGES) {
+        pages = SWAP_MAX_PAGES;
+    }
+    if (pages == 0) {
+        terminal_writestring("Swap area is smaller than a page\n");
+        return 0;
+    }
+    
+    swap_disk = *disk;
+    swap_start_lba = start_lba;
+    memset(swap_bitmap, 0, sizeof(swap_bitmap));
+    swap_used = 0;
+    swap_next = 0;
+    report_ns = clock_ns();
+    swap_pages = pages;
+    return 1;
+}
+
+int swap_enabled(void) {
+    return swap_pages != 0;
+}
+
+static int swap_slot_alloc(void) {
+    if (swap_used >= swap_pages) {
+        return -1;
+    }
+    for (uint32_t n = 0; n < swap_pages; n++) {
+        uint32_t slot = swap_next;
+        swap_next = (swap_next + 1) % swap_pages;
+        if (!(swap_bitmap[slot / 64] & (1ULL << (slot % 64)))) {
+            swap_bitmap[slot / 64] |= 1ULL << (slot % 64);
+            swap_used++;
+            return (int)slot;
+        }
+    }
+    return -1;
+}
+
+// Slot behind an entry, or -1 if the entry is not a live swap slot
+static int swap_entry_slot(uint64_t entry) {
+    uint64_t slot = (entry >> SWAP_ENTRY_SHIFT) - 1;
+    if (!entry || slot >= swap_pages || !(swap_bitmap[slot / 64] & (1ULL << (slot % 64)))) {
+        return -1;
+    }
+    return (int)slot;
+}
+
+// Copy a page out to a free slot. Returns its entry, or 0 if swap is off,
+// full or the write failed.
+uint64_t swap_write_page(const void* page) {
+    int slot = swap_slot_alloc();
+    if (slot < 0) {
+        return 0;
+    }
+    
+    uint64_t start = clock_ns();
+    uint32_t lba = swap_start_lba + (uint32_t)slot * SWAP_SECTORS_PER_PAGE;
+    if (!ata_write_sectors(&swap_disk, lba, SWAP_SECTORS_PER_PAGE, page)) {
+        terminal_writestring("WARNING: swap write failed\n");
+        swap_free_entry(((uint64_t)slot + 1) << SWAP_ENTRY_SHIFT);
+        return 0;
+    }
+    swap_record(&swap_outs, start);
+    return ((uint64_t)slot + 1) << SWAP_ENTRY_SHIFT;
+}
+
+// Make every completed swap write durable before the caller drops the
+// only other copy of the data
+int swap_sync(void) {
+    if (!swap_pages) {
+        return 0;
+    }
+    if (!ata_flush(&swap_disk)) {
+        terminal_writestring("WARNING: swap flush failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Copy a swapped page back in and release its slot
+int swap_read_page(uint64_t entry, void* page) {
+    int slot = swap_entry_slot(entry);
+    if (slot < 0) {
+        return 0;
+    }
+    
+    uint64_t start = clock_ns();
+    uint32_t lba = swap_start_lba + (uint32_t)slot * SWAP_SECTORS_PER_PAGE;
+    if (!ata_read_sectors(&swap_disk, lba, SWAP_SECTORS_PER_PAGE, page)) {
+        return 0;
+    }
+    swap_record(&swap_ins, start);
+    swap_free_entry(entry);
+    return 1;
+}
+
+void swap_free_entry(uint64_t entry) {
+    int slot = swap_entry_slot(entry);
+    if (slot >= 0) {
+        swap_bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+        swap_used--;
+    }
+}
+
+// Rates cover the interval since the previous report
+static void swap_print_stat(const char* label, swap_stat_t* stat, uint32_t recent, uint64_t interval_ns) {
+    char buffer[32];
+    terminal_writestring(label);
+    uint32_to_string(stat->count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" pages (");
+    uint32_to_string(interval_ns ? (uint32_t)((uint64_t)recent * 1000000000ULL / interval_ns) : 0, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" pages/s), avg ");
+    uint32_to_string(stat->count ? (uint32_t)((stat->ns / stat->count) / 1000) : 0, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" us, max ");
+    uint32_to_string((uint32_t)(stat->max_ns / 1000), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" us\n");
+}
+
+void swap_print_stats(void) {
+    char buffer[32];
+    
+    terminal_writestring("\nSWAP:\n");
+    if (!swap_pages) {
+        terminal_writestring("  Disabled\n");
+        return;
+    }
+    
+    terminal_writestring("  Used: ");
+    uint32_to_string(swap_used, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" of ");
+    uint32_to_string(swap_pages, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" pages (");
+    terminal_writestring(swap_disk.model);
+    terminal_writestring(" from LBA ");
+    uint32_to_string(swap_start_lba, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(")\n");
+    
+    uint64_t now = clock_ns();
+    uint64_t interval = now - report_ns;
+    swap_print_stat("  Swapped out: ", &swap_outs, swap_outs.count - report_outs, interval);
+    swap_print_stat("  Swapped in: ", &swap_ins, swap_ins.count - report_ins, interval);
+    terminal_writestring("  Rates over the last ");
+    uint32_to_string((uint32_t)(interval / 1000000), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" ms\n");
+    
+    report_outs = swap_outs.count;
+    report_ins = swap_ins.count;
+    report_ns = now;
+}
@@ -0,0 +1,182 @@
+#include "timer_wheel.h"
+#include "timer.h"
+#include "terminal.h"
+#include "string.h"
+
+#define TIMER_ROOT_MASK  (TIMER_ROOT_SIZE - 1)
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SIZE - 1)
+
+static ktimer_t* root_slots[TIMER_ROOT_SIZE];
+static ktimer_t* outer_slots[TIMER_OUTER_LEVELS][TIMER_LEVEL_SIZE];
+
+// Next tick to process. Timers are filed relative to it, so it only moves
+// in timer_wheel_run.
+static uint64_t wheel_tick = 0;
+
+static uint32_t timers_pending = 0;
+static uint64_t timers_fired = 0;
+static uint64_t timers_cascaded = 0;
+
+// The tick handler changes the wheel, so everything else works on it with
+// interrupts off, restoring the caller's interrupt flag afterwards
+static inline uint64_t timer_lock(void) {
+    uint64_t flags;
+    __asm__ volatile("pushfq; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void timer_unlock(uint64_t flags) {
+    __asm__ volatile("push %0; popfq" : : "r"(flags) : "memory", "cc");
+}
+
+static void timer_link(ktimer_t** head, ktimer_t* timer) {
+    timer->next = *head;
+    if (*head) {
+        (*head)->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void timer_unlink(ktimer_t* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Slot for a timer, by how far its expiry is from the wheel's position
+static ktimer_t** timer_slot(ktimer_t* timer) {
+    uint64_t expires = timer->expires;
+    if (expires < wheel_tick) {
+        // Already due: the slot about to be processed
+        return &root_slots[wheel_tick & TIMER_ROOT_MASK];
+    }
+    
+    uint64_t delta = expires - wheel_tick;
+    if (delta < TIMER_ROOT_SIZE) {
+        return &root_slots[expires & TIMER_ROOT_MASK];
+    }
+    if (delta > TIMER_MAX_DELAY) {
+        expires = wheel_tick + TIMER_MAX_DELAY;
+        timer->expires = expires;
+    }
+    for (int level = 0; level < TIMER_OUTER_LEVELS; level++) {
+        int shift = TIMER_ROOT_BITS + (level + 1) * TIMER_LEVEL_BITS;
+        if (level == TIMER_OUTER_LEVELS - 1 || delta < (1ULL << shift)) {
+            int index = (expires >> (shift - TIMER_LEVEL_BITS)) & TIMER_LEVEL_MASK;
+            return &outer_slots[level][index];
+        }
+    }
+    return NULL; // Not reached
+}
+
+void timer_setup(ktimer_t* timer, timer_callback_t callback, void* data) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->data = data;
+}
+
+int timer_pending(const ktimer_t* timer) {
+    return timer->pprev != NULL;
+}
+
+// Arm the timer to fire delay ticks from now, moving it if it was pending
+int timer_mod(ktimer_t* timer, uint64_t delay) {
+    uint64_t flags = timer_lock();
+    int was_pending = timer_pending(timer);
+    if (was_pending) {
+        timer_unlink(timer);
+    } else {
+        timers_pending++;
+    }
+    
+    // At least one tick out, so the timer never fires early
+    uint64_t now = timer_ticks();
+    timer->expires = now + (delay ? delay : 1);
+    timer_link(timer_slot(timer), timer);
+    timer_unlock(flags);
+    return was_pending;
+}
+
+void timer_add(ktimer_t* timer, uint64_t delay) {
+    timer_mod(timer, delay);
+}
+
+// Returns 1 if the timer was pending and will now not fire
+int timer_cancel(ktimer_t* timer) {
+    uint64_t flags = timer_lock();
+    int was_pending = timer_pending(timer);
+    if (was_pending) {
+        timer_unlink(timer);
+        timers_pending--;
+    }
+    timer_unlock(flags);
+    return was_pending;
+}
+
+// Refile every timer in an outer slot one level further in
+static int timer_cascade(int level, int index) {
+    ktimer_t* timer = outer_slots[level][index];
+    outer_slots[level][index] = NULL;
+    while (timer) {
+        ktimer_t* next = timer->next;
+        timer_link(timer_slot(timer), timer);
+        timers_cascaded++;
+        timer = next;
+    }
+    return index;
+}
+
+// Runs in the tick interrupt. Each due root slot is detached as a batch
+// and its timers fired one by one; a callback cancelling another timer of
+// the batch unlinks it from the batch instead.
+void timer_wheel_run(uint64_t now) {
+    while (wheel_tick <= now) {
+        int index = wheel_tick & TIMER_ROOT_MASK;
+        
+        // Entering a new root revolution: pull the next span in from each
+        // level whose own slot wrapped too
+        if (index == 0) {
+            for (int level = 0; level < TIMER_OUTER_LEVELS; level++) {
+                int shift = TIMER_ROOT_BITS + level * TIMER_LEVEL_BITS;
+                if (timer_cascade(level, (wheel_tick >> shift) & TIMER_LEVEL_MASK) != 0) {
+                    break;
+                }
+            }
+        }
+        
+        ktimer_t* batch = root_slots[index];
+        root_slots[index] = NULL;
+        if (batch) {
+            batch->pprev = &batch;
+        }
+        wheel_tick++;
+        
+        while (batch) {
+            ktimer_t* timer = batch;
+            timer_unlink(timer);
+            timers_pending--;
+            timers_fired++;
+            timer->callback(timer->data);
+        }
+    }
+}
+
+void timer_wheel_print_stats(void) {
+    char buffer[32];
+    terminal_writestring("Timers: ");
+    uint32_to_string(timers_pending, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" pending, ");
+    uint32_to_string((uint32_t)timers_fired, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" fired, ");
+    uint32_to_string((uint32_t)timers_cascaded, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" cascaded\n");
+}
@@ -0,0 +1,775 @@
+#include "vmm.h"
+#include "frame.h"
+#include "slab.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+
+// The kernel runs on the boot page tables; new tables come from the frame
+// allocator and are reached through the identity map
+static address_space_t kernel_space;
+static uint64_t* kernel_pml4 = NULL;
+static uint64_t identity_limit = FRAME_IDENTITY_LIMIT;
+static int huge_pages_supported = 0;
+static int nx_supported = 0;
+static int pge_enabled = 0;
+static int pcid_enabled = 0;
+static int pat_enabled = 0;
+static uint64_t mmio_next = VMM_MMIO_BASE;
+static size_t table_frames = 0;       // Page-table frames allocated since boot
+
+// User address spaces, so new kernel PML4 entries reach all of them
+static address_space_t* space_list = NULL;
+static kmem_cache_t* space_cache = NULL;
+
+// PCIDs in use, and freed ones whose TLB entries may still be cached.
+// Dirty PCIDs are only handed out again after a full TLB flush.
+static uint64_t pcid_used[VMM_PCID_COUNT / 64];
+static uint64_t pcid_dirty[VMM_PCID_COUNT / 64];
+
+// TLB invalidation owed by one page-table operation. It lives on the
+// caller's stack: allocating a table can reclaim memory through swap,
+// which runs a whole operation of its own in the middle of this one.
+typedef struct {
+    size_t count;                    // Pages invalidated
+    int full;                        // Touched entries invlpg cannot reach
+} vmm_flush_t;
+
+static inline void vmm_cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+static inline uint64_t vmm_read_cr0(void) {
+    uint64_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void vmm_write_cr0(uint64_t cr0) {
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+static inline uint64_t vmm_read_cr3(void) {
+    uint64_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+static inline void vmm_write_cr3(uint64_t cr3) {
+    __asm__ volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+}
+
+static inline uint64_t vmm_read_cr4(void) {
+    uint64_t cr4;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static inline void vmm_write_cr4(uint64_t cr4) {
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+static inline void vmm_invlpg(uint64_t virt) {
+    __asm__ volatile("invlpg (%0)" : : "r"(virt) : "memory");
+}
+
+// Level 3 is the PML4, level 0 the page table
+static inline int vmm_index(uint64_t virt, int level) {
+    return (int)((virt >> (12 + 9 * level)) & (VMM_ENTRIES - 1));
+}
+
+static inline uint64_t vmm_level_size(int level) {
+    return 1ULL << (12 + 9 * level);
+}
+
+static inline uint64_t* vmm_table(uint64_t entry) {
+    return (uint64_t*)(uintptr_t)(entry & VMM_PTE_ADDR_MASK);
+}
+
+static inline int vmm_is_kernel_address(uint64_t virt) {
+    return virt < VMM_USER_BASE || virt >= VMM_USER_TOP;
+}
+
+static inline int vmm_is_kernel_slot(int index) {
+    return index == 0 || index >= VMM_ENTRIES / 2;
+}
+
+static inline int vmm_is_user_range(uint64_t virt, size_t size) {
+    return virt >= VMM_USER_BASE && virt < VMM_USER_TOP && size <= VMM_USER_TOP - virt;
+}
+
+// Invalidate the whole TLB, global entries and every PCID included
+static void vmm_flush_all(void) {
+    if (pge_enabled) {
+        uint64_t cr4 = vmm_read_cr4();
+        vmm_write_cr4(cr4 & ~(1ULL << 7));
+        vmm_write_cr4(cr4);
+    } else {
+        vmm_write_cr3(vmm_read_cr3());
+    }
+}
+
+// Drop the stale translation for one page. Kernel leaves are global, and
+// invlpg removes global translations under every PCID. A user page of
+// another address space is cached under that space's PCID, which only a
+// full flush reaches. A long run of changes is also cheaper to finish
+// with one full flush.
+static void vmm_flush_page(vmm_flush_t* flush, uint64_t* pml4, uint64_t virt) {
+    if (!vmm_is_kernel_address(virt) && pml4 != vmm_table(vmm_read_cr3())) {
+        // Without PCIDs, that space's entries went away when CR3 last changed
+        if (pcid_enabled) {
+            flush->full = 1;
+        }
+        return;
+    }
+    if (flush->count < VMM_INVLPG_MAX) {
+        vmm_invlpg(virt);
+    }
+    flush->count++;
+}
+
+static void vmm_flush_finish(vmm_flush_t* flush) {
+    if (flush->full || flush->count >= VMM_INVLPG_MAX) {
+        vmm_flush_all();
+    }
+}
+
+// Leaf entry bits for a mapping at the given level. Kernel mappings are
+// global so they stay cached across address space switches.
+static uint64_t vmm_leaf_bits(uint32_t flags, int level, uint64_t virt) {
+    uint64_t bits = VMM_PTE_PRESENT;
+    if (flags & VMM_MAP_WRITE) {
+        bits |= VMM_PTE_WRITE;
+    }
+    if (flags & VMM_MAP_USER) {
+        bits |= VMM_PTE_USER;
+    }
+    if (flags & VMM_MAP_NOCACHE) {
+        bits |= VMM_PTE_PCD | VMM_PTE_PWT;
+    }
+    if (flags & VMM_MAP_WRITETHROUGH) {
+        bits |= VMM_PTE_PWT;
+    }
+    if (flags & VMM_MAP_WRITECOMBINE) {
+        if (pat_enabled) {
+            bits |= level > 0 ? VMM_PTE_PAT_LARGE : VMM_PTE_PAT;
+        } else {
+            bits |= VMM_PTE_PCD | VMM_PTE_PWT;
+        }
+    }
+    if ((flags & VMM_MAP_NOEXEC) && nx_supported) {
+        bits |= VMM_PTE_NX;
+    }
+    if (level > 0) {
+        bits |= VMM_PTE_LARGE;
+    }
+    if (pge_enabled && vmm_is_kernel_address(virt)) {
+        bits |= VMM_PTE_GLOBAL;
+    }
+    return bits;
+}
+
+// A zeroed page-table frame. Zeroed frames lie inside the identity map,
+// so the kernel can fill the table in.
+static uint64_t* vmm_alloc_table(void) {
+    uint64_t phys = frame_alloc_zeroed();
+    if (!phys) {
+        return NULL;
+    }
+
+    table_frames++;
+    return (uint64_t*)(uintptr_t)phys;
+}
+
+static void vmm_free_table(uint64_t* table) {
+    frame_free((uint64_t)(uintptr_t)table);
+    table_frames--;
+}
+
+// A new kernel-half PML4 entry has to appear in every address space
+static void vmm_sync_kernel_slot(int index) {
+    for (address_space_t* space = space_list; space; space = space->next) {
+        space->pml4[index] = kernel_pml4[index];
+    }
+}
+
+// Table below a level-`level` entry, creating it if the entry is empty or
+// splitting a large leaf into 512 smaller ones that map the same memory.
+// Permissions are enforced at the leaves, so table entries allow all.
+static uint64_t* vmm_next_table(vmm_flush_t* flush, uint64_t* pml4, uint64_t* entry, int level, uint64_t virt) {
+    if ((*entry & VMM_PTE_PRESENT) && !(*entry & VMM_PTE_LARGE)) {
+        return vmm_table(*entry);
+    }
+
+    uint64_t* table = vmm_alloc_table();
+    if (!table) {
+        return NULL;
+    }
+
+    if (*entry & VMM_PTE_PRESENT) {
+        uint64_t child_size = vmm_level_size(level - 1);
+        uint64_t phys = *entry & VMM_PTE_ADDR_MASK & ~(vmm_level_size(level) - 1);
+        uint64_t bits = (*entry & ~VMM_PTE_ADDR_MASK) | (*entry & VMM_PTE_PAT_LARGE);
+        if (level - 1 == 0) {
+            // The PAT bit moves down to bit 7 in 4KB entries
+            bits &= ~(VMM_PTE_LARGE | VMM_PTE_PAT_LARGE);
+            if (*entry & VMM_PTE_PAT_LARGE) {
+                bits |= VMM_PTE_PAT;
+            }
+        }
+        for (int i = 0; i < VMM_ENTRIES; i++) {
+            table[i] = (phys + i * child_size) | bits;
+        }
+        *entry = (uint64_t)(uintptr_t)table | VMM_PTE_PRESENT | VMM_PTE_WRITE | VMM_PTE_USER;
+        vmm_flush_page(flush, pml4, virt & ~(vmm_level_size(level) - 1));
+        return table;
+    }
+
+    *entry = (uint64_t)(uintptr_t)table | VMM_PTE_PRESENT | VMM_PTE_WRITE | VMM_PTE_USER;
+    if (level == 3 && pml4 == kernel_pml4 && vmm_is_kernel_slot(vmm_index(virt, 3))) {
+        vmm_sync_kernel_slot(vmm_index(virt, 3));
+    }
+    return table;
+}
+
+// Entry for virt at the given level, creating tables on the way down
+static uint64_t* vmm_walk_create(vmm_flush_t* flush, uint64_t* pml4, uint64_t virt, int level) {
+    uint64_t* table = pml4;
+    for (int l = 3; l > level; l--) {
+        table = vmm_next_table(flush, pml4, &table[vmm_index(virt, l)], l, virt);
+        if (!table) {
+            return NULL;
+        }
+    }
+    return &table[vmm_index(virt, level)];
+}
+
+// Leaf entry mapping virt and its level. If virt is unmapped, returns NULL
+// with level set to where the walk stopped.
+static uint64_t* vmm_find_leaf(uint64_t* pml4, uint64_t virt, int* level) {
+    uint64_t* table = pml4;
+    for (int l = 3; l >= 0; l--) {
+        uint64_t* entry = &table[vmm_index(virt, l)];
+        *level = l;
+        if (!(*entry & VMM_PTE_PRESENT)) {
+            return NULL;
+        }
+        if (l == 0 || (*entry & VMM_PTE_LARGE)) {
+            return entry;
+        }
+        table = vmm_table(*entry);
+    }
+    return NULL;
+}
+
+// Largest page size that fits the alignment of both addresses and the size
+static int vmm_leaf_level(uint64_t virt, uint64_t phys, size_t size) {
+    if (huge_pages_supported && !((virt | phys) & (VMM_HUGE_PAGE_SIZE - 1)) && size >= VMM_HUGE_PAGE_SIZE) {
+        return 2;
+    }
+    if (!((virt | phys) & (VMM_LARGE_PAGE_SIZE - 1)) && size >= VMM_LARGE_PAGE_SIZE) {
+        return 1;
+    }
+    return 0;
+}
+
+static int vmm_map_range(uint64_t* pml4, uint64_t virt, uint64_t phys, size_t size, uint32_t flags) {
+    if (!pml4 || size == 0 || ((virt | phys | size) & (VMM_PAGE_SIZE - 1))) {
+        return 0;
+    }
+
+    vmm_flush_t flush = {0, 0};
+    int ok = 1;
+    while (size > 0) {
+        int level = vmm_leaf_level(virt, phys, size);
+        uint64_t* entry = vmm_walk_create(&flush, pml4, virt, level);
+
+        // Smaller pages are already mapped below this entry - map inside
+        // the existing table rather than freeing it
+        while (entry && level > 0 && (*entry & VMM_PTE_PRESENT) && !(*entry & VMM_PTE_LARGE)) {
+            level--;
+            entry = vmm_walk_create(&flush, pml4, virt, level);
+        }
+        if (!entry) {
+            ok = 0;
+            break;
+        }
+
+        if (*entry & VMM_PTE_PRESENT) {
+            vmm_flush_page(&flush, pml4, virt);
+        }
+        *entry = phys | vmm_leaf_bits(flags, level, virt);
+
+        uint64_t step = vmm_level_size(level);
+        virt += step;
+        phys += step;
+        size -= step;
+    }
+
+    vmm_flush_finish(&flush);
+    return ok;
+}
+
+// Clear or re-flag every leaf in [virt, virt + size), splitting large
+// pages the range only partly covers. Returns 0 if part of the range was
+// not mapped or a split failed.
+static int vmm_update_range(uint64_t* pml4, uint64_t virt, size_t size, int unmap, uint32_t flags) {
+    if (!pml4 || ((virt | size) & (VMM_PAGE_SIZE - 1))) {
+        return 0;
+    }
+
+    vmm_flush_t flush = {0, 0};
+    int ok = 1;
+    uint64_t end = virt + size;
+    while (virt < end) {
+        int level;
+        uint64_t* entry = vmm_find_leaf(pml4, virt, &level);
+        uint64_t page = vmm_level_size(level);
+        uint64_t base = virt & ~(page - 1);
+
+        if (!entry) {
+            // Skip the whole unmapped region below this entry
+            if (!unmap) {
+                ok = 0;
+            }
+            virt = base + page;
+            continue;
+        }
+
+        if (base < virt || base + page > end) {
+            if (!vmm_next_table(&flush, pml4, entry, level, virt)) {
+                ok = 0;
+                break;
+            }
+            continue;
+        }
+
+        if (unmap) {
+            *entry = 0;
+        } else {
+            *entry = (*entry & VMM_PTE_ADDR_MASK & ~(page - 1)) | vmm_leaf_bits(flags, level, base);
+        }
+        vmm_flush_page(&flush, pml4, base);
+        virt = base + page;
+    }
+
+    vmm_flush_finish(&flush);
+    return ok;
+}
+
+// 4KB entry for virt, present or not, if a page table covers it
+static uint64_t* vmm_find_pte(uint64_t* pml4, uint64_t virt) {
+    uint64_t* table = pml4;
+    for (int l = 3; l > 0; l--) {
+        uint64_t entry = table[vmm_index(virt, l)];
+        if (!(entry & VMM_PTE_PRESENT) || (entry & VMM_PTE_LARGE)) {
+            return NULL;
+        }
+        table = vmm_table(entry);
+    }
+    return &table[vmm_index(virt, 0)];
+}
+
+static uint64_t vmm_translate_in(uint64_t* pml4, uint64_t virt) {
+    int level;
+    uint64_t* entry = pml4 ? vmm_find_leaf(pml4, virt, &level) : NULL;
+    if (!entry) {
+        return 0;
+    }
+
+    uint64_t page = vmm_level_size(level);
+    return (*entry & VMM_PTE_ADDR_MASK & ~(page - 1)) | (virt & (page - 1));
+}
+
+int vmm_map(uint64_t virt, uint64_t phys, size_t size, uint32_t flags) {
+    return vmm_map_range(kernel_pml4, virt, phys, size, flags);
+}
+
+int vmm_unmap(uint64_t virt, size_t size) {
+    return vmm_update_range(kernel_pml4, virt, size, 1, 0);
+}
+
+int vmm_protect(uint64_t virt, size_t size, uint32_t flags) {
+    return vmm_update_range(kernel_pml4, virt, size, 0, flags);
+}
+
+// Physical address behind virt, or 0 if it is not mapped
+uint64_t vmm_translate(uint64_t virt) {
+    return vmm_translate_in(kernel_pml4, virt);
+}
+
+// Whether the 4KB page at virt was used since the last call. Tests and
+// clears the accessed bit, then flushes the translation: the page is a
+// global kernel mapping, and while it stays cached the CPU would not set
+// the bit again, so a hot page would look cold on the next pass.
+int vmm_test_accessed(uint64_t virt) {
+    uint64_t* entry = vmm_find_pte(kernel_pml4, virt);
+    if (!entry || !(*entry & VMM_PTE_PRESENT) || !(*entry & VMM_PTE_ACCESSED)) {
+        return 0;
+    }
+    *entry &= ~VMM_PTE_ACCESSED;
+    vmm_invlpg(virt);
+    return 1;
+}
+
+// Replace the 4KB entry at virt, mapped or not, with a non-present one
+// holding value. Fails if no page table covers virt.
+int vmm_set_swap_entry(uint64_t virt, uint64_t value) {
+    uint64_t* entry = vmm_find_pte(kernel_pml4, virt);
+    if (!entry || (value & VMM_PTE_PRESENT)) {
+        return 0;
+    }
+    uint64_t old = *entry;
+    *entry = value;
+    if (old & VMM_PTE_PRESENT) {
+        vmm_flush_t flush = {0, 0};
+        vmm_flush_page(&flush, kernel_pml4, virt);
+        vmm_flush_finish(&flush);
+    }
+    return 1;
+}
+
+uint64_t vmm_swap_entry(uint64_t virt) {
+    uint64_t* entry = vmm_find_pte(kernel_pml4, virt);
+    if (!entry || (*entry & VMM_PTE_PRESENT)) {
+        return 0;
+    }
+    return *entry;
+}
+
+int vmm_space_map(address_space_t* space, uint64_t virt, uint64_t phys, size_t size, uint32_t flags) {
+    if (!space || !vmm_is_user_range(virt, size)) {
+        return 0;
+    }
+    return vmm_map_range(space->pml4, virt, phys, size, flags);
+}
+
+int vmm_space_unmap(address_space_t* space, uint64_t virt, size_t size) {
+    if (!space || !vmm_is_user_range(virt, size)) {
+        return 0;
+    }
+    return vmm_update_range(space->pml4, virt, size, 1, 0);
+}
+
+int vmm_space_protect(address_space_t* space, uint64_t virt, size_t size, uint32_t flags) {
+    if (!space || !vmm_is_user_range(virt, size)) {
+        return 0;
+    }
+    return vmm_update_range(space->pml4, virt, size, 0, flags);
+}
+
+uint64_t vmm_space_translate(address_space_t* space, uint64_t virt) {
+    return space ? vmm_translate_in(space->pml4, virt) : 0;
+}
+
+// Map device memory into the kernel MMIO window. The window address keeps
+// the same offset within 2MB as phys, so large apertures get large pages.
+void* vmm_map_mmio(uint64_t phys, size_t size, uint32_t flags) {
+    uint64_t offset = phys & (VMM_PAGE_SIZE - 1);
+    uint64_t base = phys - offset;
+    size = (size + offset + VMM_PAGE_SIZE - 1) & ~(VMM_PAGE_SIZE - 1);
+
+    uint64_t virt = ((mmio_next + VMM_LARGE_PAGE_SIZE - 1) & ~(VMM_LARGE_PAGE_SIZE - 1)) +
+                    (base & (VMM_LARGE_PAGE_SIZE - 1));
+    if (size == 0 || virt + size > VMM_MMIO_BASE + VMM_MMIO_SIZE) {
+        return NULL;
+    }
+
+    if (!vmm_map(virt, base, size, flags)) {
+        vmm_unmap(virt, size);
+        return NULL;
+    }
+
+    mmio_next = virt + size;
+    return (void*)(uintptr_t)(virt + offset);
+}
+
+uint64_t vmm_identity_limit(void) {
+    return identity_limit;
+}
+
+// Whether VMM_MAP_WRITECOMBINE really gives write-combining
+int vmm_write_combining(void) {
+    return pat_enabled;
+}
+
+// Take a clean PCID, flushing the TLB to recycle freed ones if needed
+static uint16_t vmm_pcid_alloc(void) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int word = 0; word < VMM_PCID_COUNT / 64; word++) {
+            uint64_t busy = pcid_used[word] | pcid_dirty[word];
+            if (~busy) {
+                int bit = __builtin_ctzll(~busy);
+                pcid_used[word] |= 1ULL << bit;
+                return (uint16_t)(word * 64 + bit);
+            }
+        }
+        vmm_flush_all();
+        memset(pcid_dirty, 0, sizeof(pcid_dirty));
+    }
+    return 0;
+}
+
+static void vmm_pcid_free(uint16_t pcid) {
+    pcid_used[pcid / 64] &= ~(1ULL << (pcid % 64));
+    pcid_dirty[pcid / 64] |= 1ULL << (pcid % 64);
+}
+
+address_space_t* address_space_kernel(void) {
+    return &kernel_space;
+}
+
+// A new address space: an empty user half plus the shared kernel entries
+address_space_t* address_space_create(void) {
+    if (!kernel_pml4) {
+        return NULL;
+    }
+    if (!space_cache) {
+        space_cache = kmem_cache_create("address_space", sizeof(address_space_t), 0, NULL);
+    }
+
+    address_space_t* space = (address_space_t*)kmem_cache_alloc(space_cache);
+    if (!space) {
+        return NULL;
+    }
+
+    space->pml4 = vmm_alloc_table();
+    if (!space->pml4) {
+        kmem_cache_free(space_cache, space);
+        return NULL;
+    }
+    for (int i = 0; i < VMM_ENTRIES; i++) {
+        if (vmm_is_kernel_slot(i)) {
+            space->pml4[i] = kernel_pml4[i];
+        }
+    }
+
+    // A clean PCID has nothing cached, so even the first switch can keep
+    // the TLB
+    space->pcid = pcid_enabled ? vmm_pcid_alloc() : 0;
+    space->cr3 = (uint64_t)(uintptr_t)space->pml4;
+    if (space->pcid) {
+        space->cr3 |= space->pcid | VMM_CR3_NOFLUSH;
+    }
+    space->refcount = 1;
+
+    space->next = space_list;
+    space_list = space;
+    return space;
+}
+
+void address_space_retain(address_space_t* space) {
+    if (space && space != &kernel_space) {
+        space->refcount++;
+    }
+}
+
+// Free the page tables under one user-half entry
+static void vmm_free_tables(uint64_t* table, int level) {
+    if (level > 0) {
+        for (int i = 0; i < VMM_ENTRIES; i++) {
+            if ((table[i] & VMM_PTE_PRESENT) && !(table[i] & VMM_PTE_LARGE)) {
+                vmm_free_tables(vmm_table(table[i]), level - 1);
+            }
+        }
+    }
+    vmm_free_table(table);
+}
+
+void address_space_release(address_space_t* space) {
+    if (!space || space == &kernel_space || --space->refcount > 0) {
+        return;
+    }
+
+    // A terminating process still runs on its own tables
+    if (vmm_table(vmm_read_cr3()) == space->pml4) {
+        vmm_write_cr3(kernel_space.cr3);
+    }
+
+    address_space_t** link = &space_list;
+    while (*link && *link != space) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = space->next;
+    }
+
+    for (int i = 0; i < VMM_ENTRIES; i++) {
+        if (!vmm_is_kernel_slot(i) && (space->pml4[i] & VMM_PTE_PRESENT)) {
+            vmm_free_tables(vmm_table(space->pml4[i]), 2);
+        }
+    }
+    vmm_free_table(space->pml4);
+    if (space->pcid) {
+        vmm_pcid_free(space->pcid);
+    }
+    kmem_cache_free(space_cache, space);
+}
+
+// Mark every leaf below a kernel table global
+static void vmm_mark_global(uint64_t* table, int level) {
+    for (int i = 0; i < VMM_ENTRIES; i++) {
+        if (!(table[i] & VMM_PTE_PRESENT)) {
+            continue;
+        }
+        if (level == 0 || (table[i] & VMM_PTE_LARGE)) {
+            table[i] |= VMM_PTE_GLOBAL;
+        } else {
+            vmm_mark_global(vmm_table(table[i]), level - 1);
+        }
+    }
+}
+
+void vmm_init(void) {
+    kernel_pml4 = (uint64_t*)(uintptr_t)(vmm_read_cr3() & VMM_PTE_ADDR_MASK);
+
+    uint32_t eax, ebx, ecx, edx;
+    vmm_cpuid(1, &eax, &ebx, &ecx, &edx);
+    int pge_supported = (edx >> 13) & 1;
+    int pcid_supported = (ecx >> 17) & 1;
+    int pat_supported = (edx >> 16) & 1;
+
+    vmm_cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000001) {
+        vmm_cpuid(0x80000001, &eax, &ebx, &ecx, &edx);
+        huge_pages_supported = (edx >> 26) & 1;
+        nx_supported = (edx >> 20) & 1;
+    }
+
+    // Everything runs in ring 0, and supervisor writes ignore read-only
+    // entries unless CR0.WP is set. Copy-on-write and dirty tracking of
+    // mapped files rely on those writes faulting.
+    vmm_write_cr0(vmm_read_cr0() | (1ULL << 16));
+
+    // NX is only honoured once EFER.NXE is set
+    if (nx_supported) {
+        uint32_t low, high;
+        __asm__ volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(0xC0000080));
+        low |= 1 << 11;
+        __asm__ volatile("wrmsr" : : "a"(low), "d"(high), "c"(0xC0000080));
+    }
+
+    // boot.asm only identity-maps the first 1GB; extend it over all RAM
+    uint64_t top = (frame_memory_top() + VMM_LARGE_PAGE_SIZE - 1) & ~(VMM_LARGE_PAGE_SIZE - 1);
+    if (top > identity_limit) {
+        if (vmm_map(identity_limit, identity_limit, top - identity_limit, VMM_MAP_WRITE)) {
+            identity_limit = top;
+        } else {
+            terminal_writestring("WARNING: Could not identity-map memory above 1GB\n");
+        }
+    }
+
+    // Reprogram one PAT entry for write-combining. Caches and TLB are
+    // flushed around the change; nothing maps with that entry yet.
+    if (pat_supported) {
+        __asm__ volatile("wbinvd" : : : "memory");
+        __asm__ volatile("wrmsr" : : "a"((uint32_t)VMM_PAT_VALUE), "d"((uint32_t)(VMM_PAT_VALUE >> 32)),
+                         "c"(VMM_PAT_MSR));
+        __asm__ volatile("wbinvd" : : : "memory");
+        vmm_write_cr3(vmm_read_cr3());
+        pat_enabled = 1;
+    }
+
+    // Global kernel pages survive CR3 loads, and PCIDs let each address
+    // space keep its own entries across switches (CR3 has PCID 0 here)
+    if (pge_supported) {
+        vmm_mark_global(vmm_table(kernel_pml4[0]), 2);
+        vmm_write_cr4(vmm_read_cr4() | (1ULL << 7));
+        pge_enabled = 1;
+        if (pcid_supported) {
+            vmm_write_cr4(vmm_read_cr4() | (1ULL << 17));
+            pcid_enabled = 1;
+            pcid_used[0] |= 1; // PCID 0 is the kernel's
+        }
+    }
+
+    kernel_space.pml4 = kernel_pml4;
+    kernel_space.cr3 = (uint64_t)(uintptr_t)kernel_pml4;
+    kernel_space.pcid = 0;
+    kernel_space.refcount = 1;
+    kernel_space.next = NULL;
+
+    terminal_writestring("Virtual memory: ");
+    char buffer[32];
+    uint32_to_string((uint32_t)(identity_limit / (1024 * 1024)), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(huge_pages_supported ? "MB identity mapped, 1GB pages" : "MB identity mapped, 2MB pages");
+    terminal_writestring(pcid_enabled ? ", PCID" : "");
+    terminal_writestring(pat_enabled ? ", PAT\n" : "\n");
+}
+
+void vmm_print_stats(void) {
+    if (!kernel_pml4) {
+        return;
+    }
+
+    // Count leaves of each size across the kernel's hierarchy
+    size_t leaves[3] = {0, 0, 0};
+    for (int i = 0; i < VMM_ENTRIES; i++) {
+        if (!(kernel_pml4[i] & VMM_PTE_PRESENT)) {
+            continue;
+        }
+        uint64_t* pdpt = vmm_table(kernel_pml4[i]);
+        for (int j = 0; j < VMM_ENTRIES; j++) {
+            if (!(pdpt[j] & VMM_PTE_PRESENT)) {
+                continue;
+            }
+            if (pdpt[j] & VMM_PTE_LARGE) {
+                leaves[2]++;
+                continue;
+            }
+            uint64_t* pd = vmm_table(pdpt[j]);
+            for (int k = 0; k < VMM_ENTRIES; k++) {
+                if (!(pd[k] & VMM_PTE_PRESENT)) {
+                    continue;
+                }
+                if (pd[k] & VMM_PTE_LARGE) {
+                    leaves[1]++;
+                    continue;
+                }
+                uint64_t* pt = vmm_table(pd[k]);
+                for (int l = 0; l < VMM_ENTRIES; l++) {
+                    if (pt[l] & VMM_PTE_PRESENT) {
+                        leaves[0]++;
+                    }
+                }
+            }
+        }
+    }
+
+    size_t space_count = 0;
+    for (address_space_t* space = space_list; space; space = space->next) {
+        space_count++;
+    }
+
+    char buffer[32];
+    terminal_writestring("\nVIRTUAL MEMORY:\n");
+    terminal_writestring("  Identity mapped: ");
+    uint32_to_string((uint32_t)(identity_limit / (1024 * 1024)), buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" MB\n");
+
+    terminal_writestring("  Kernel pages: ");
+    uint32_to_string((uint32_t)leaves[2], buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" x 1GB, ");
+    uint32_to_string((uint32_t)leaves[1], buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" x 2MB, ");
+    uint32_to_string((uint32_t)leaves[0], buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(" x 4KB\n");
+
+    terminal_writestring("  Page tables allocated: ");
+    uint32_to_string((uint32_t)table_frames, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring("\n");
+
+    terminal_writestring("  Address spaces: ");
+    uint32_to_string((uint32_t)space_count, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(pcid_enabled ? " (PCID tagged)\n" : "\n");
+
+    terminal_writestring("  Write-combining: ");
+    terminal_writestring(pat_enabled ? "PAT entry 4\n" : "unavailable (uncached)\n");
+}
@@ -0,0 +1,66 @@
+// Host side of the heap replay tool: libc services and the kernel symbols
+// that memory.c expects. Built with the host compiler and headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "host.h"
+
+// Linker script symbols referenced by memory_print_stats
+char kernel_start[1], kernel_end[1];
+char text_start[1], text_end[1];
+char rodata_start[1], rodata_end[1];
+char data_start[1], data_end[1];
+char bss_start[1], bss_end[1];
+
+static int host_quiet = 0;
+
+void terminal_writestring(const char* str) {
+    if (!host_quiet) {
+        fputs(str, stdout);
+    }
+}
+
+void terminal_putchar(char c) {
+    if (!host_quiet) {
+        putchar(c);
+    }
+}
+
+void host_set_quiet(int quiet) {
+    host_quiet = quiet;
+}
+
+void* host_read_file(const char* path, unsigned long* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    void* data = length > 0 ? malloc(length) : NULL;
+    if (data && fread(data, 1, length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = data ? (unsigned long)length : 0;
+    return data;
+}
+
+void* host_alloc(unsigned long size) {
+    return malloc(size);
+}
+
+void host_free(void* ptr) {
+    free(ptr);
+}
+
+unsigned long long host_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -0,0 +1,14 @@
+#ifndef HOST_H
+#define HOST_H
+
+// Services the hosted heap replay needs from the host C library. Plain C
+// types only, so this header works from both the kernel-flag and the libc
+// side of the build.
+
+void* host_read_file(const char* path, unsigned long* size);
+void* host_alloc(unsigned long size);
+void host_free(void* ptr);
+unsigned long long host_time_ns(void);
+void host_set_quiet(int quiet);
+
+#endif // HOST_H
@@ -0,0 +1,291 @@
+// Hosted replay of kernel allocation traces recorded with 'memtrace'.
+// Built with the kernel compiler flags against the unmodified
+// src/kernel/memory.c, so it measures the allocator the kernel ships.
+#include "memory.h"
+#include "terminal.h"
+#include "string.h"
+#include "memory_utils.h"
+#include "host.h"
+
+#define REPLAY_ROUNDS        20       // Timed runs per trace; the best is reported
+#define REPLAY_ID_SLOTS      8192     // Live blocks tracked (power of two)
+#define SYNTHETIC_OPS        20000
+#define SYNTHETIC_SLOTS      512
+
+// Trace id -> block returned by this replay, open-addressed with
+// tombstones: ids span several zones, so a flat array no longer fits
+#define REPLAY_ID_DELETED    0xFFFFFFFFu
+
+typedef struct {
+    uint32_t id;                      // 0 = empty
+    void* ptr;
+} replay_id_t;
+
+static replay_id_t id_map[REPLAY_ID_SLOTS];
+
+typedef struct {
+    uint64_t best_ns;                 // Fastest full replay
+    size_t peak_allocated;            // Highest live block bytes
+    size_t peak_footprint;            // Highest zone bytes not on a free list
+    uint32_t final_fragmentation;
+    uint32_t max_fragmentation;
+    uint32_t failed;                  // Allocations that returned NULL
+} replay_result_t;
+
+static void print_number(const char* label, uint64_t value, const char* unit) {
+    char buffer[32];
+    terminal_writestring(label);
+    uint32_to_string((uint32_t)value, buffer);
+    terminal_writestring(buffer);
+    terminal_writestring(unit);
+}
+
+static replay_id_t* find_id(uint32_t id, int insert) {
+    uint32_t index = (id * 2654435761u) & (REPLAY_ID_SLOTS - 1);
+    replay_id_t* reuse = NULL;
+    
+    for (int probe = 0; probe < REPLAY_ID_SLOTS; probe++) {
+        replay_id_t* slot = &id_map[index];
+        if (slot->id == id) {
+            return slot;
+        }
+        if (slot->id == REPLAY_ID_DELETED && !reuse) {
+            reuse = slot;
+        }
+        if (slot->id == 0) {
+            if (!insert) {
+                return NULL;
+            }
+            return reuse ? reuse : slot;
+        }
+        index = (index + 1) & (REPLAY_ID_SLOTS - 1);
+    }
+    return insert ? reuse : NULL;
+}
+
+static void* lookup(uint32_t id) {
+    replay_id_t* slot = id ? find_id(id, 0) : NULL;
+    return slot ? slot->ptr : NULL;
+}
+
+static void remember(uint32_t id, void* ptr) {
+    if (!id) {
+        return;
+    }
+    if (!ptr) {
+        replay_id_t* slot = find_id(id, 0);
+        if (slot) {
+            slot->id = REPLAY_ID_DELETED;
+            slot->ptr = NULL;
+        }
+        return;
+    }
+    replay_id_t* slot = find_id(id, 1);
+    if (slot) {
+        slot->id = id;
+        slot->ptr = ptr;
+    }
+}
+
+// Apply one traced call; returns 0 if an allocation failed
+static int replay_entry(const memory_trace_entry_t* entry) {
+    switch (entry->op) {
+        case MEMORY_TRACE_ALLOC: {
+            if (!entry->id) {
+                return 1; // Failed when recorded - nothing to track
+            }
+            void* ptr = entry->align ? kmalloc_aligned(entry->size, entry->align)
+                                     : kmalloc(entry->size);
+            remember(entry->id, ptr);
+            return ptr != NULL;
+        }
+        case MEMORY_TRACE_FREE: {
+            void* ptr = lookup(entry->id);
+            if (ptr) {
+                kfree(ptr);
+                remember(entry->id, NULL);
+            }
+            return 1;
+        }
+        case MEMORY_TRACE_REALLOC: {
+            void* old_ptr = lookup(entry->old_id);
+            void* ptr = krealloc(old_ptr, entry->size);
+            if (ptr || entry->size == 0) {
+                // On failure the old block stays live under its old id
+                remember(entry->old_id, NULL);
+                remember(entry->id, ptr);
+            }
+            return ptr != NULL || entry->size == 0;
+        }
+    }
+    return 1;
+}
+
+static void replay_begin(void) {
+    memset(id_map, 0, sizeof(id_map));
+    host_set_quiet(1);
+    memory_hosted_reset();
+}
+
+static void replay_trace(const memory_trace_entry_t* entries, uint32_t count, replay_result_t* result) {
+    memset(result, 0, sizeof(*result));
+    result->best_ns = (uint64_t)-1;
+
+    // Timed passes: nothing but the allocator calls inside the clock
+    for (int round = 0; round < REPLAY_ROUNDS; round++) {
+        replay_begin();
+        uint64_t start = host_time_ns();
+        for (uint32_t i = 0; i < count; i++) {
+            replay_entry(&entries[i]);
+        }
+        uint64_t elapsed = host_time_ns() - start;
+        if (elapsed < result->best_ns) {
+            result->best_ns = elapsed;
+        }
+    }
+
+    // Measured pass: sample the heap telemetry after every call
+    replay_begin();
+    memory_stats_t stats;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!replay_entry(&entries[i])) {
+            result->failed++;
+        }
+
+        memory_get_stats(&stats);
+        size_t footprint = stats.total_bytes - stats.free_bytes;
+        if (footprint > result->peak_footprint) {
+            result->peak_footprint = footprint;
+        }
+        if (stats.fragmentation > result->max_fragmentation) {
+            result->max_fragmentation = stats.fragmentation;
+        }
+    }
+    result->peak_allocated = stats.peak_allocated;
+    result->final_fragmentation = stats.fragmentation;
+    host_set_quiet(0);
+}
+
+static void print_result(const char* name, uint32_t count, uint32_t dropped, const replay_result_t* result) {
+    terminal_writestring(name);
+    print_number(": ", count, " calls");
+    if (dropped) {
+        print_number(" (", dropped, " older calls were not recorded)");
+    }
+    terminal_writestring("\n");
+
+    uint64_t per_op_ps = count ? result->best_ns * 1000 / count : 0;
+    print_number("  Time: ", per_op_ps / 1000, ".");
+    char buffer[32];
+    uint32_to_string_padded((uint32_t)(per_op_ps % 1000), buffer, 3, '0');
+    terminal_writestring(buffer);
+    print_number(" ns/op (best of ", REPLAY_ROUNDS, ")\n");
+    print_number("  Peak allocated: ", result->peak_allocated, " bytes\n");
+    print_number("  Peak footprint: ", result->peak_footprint, " bytes\n");
+    print_number("  Fragmentation: ", result->final_fragmentation, "% at end, ");
+    print_number("", result->max_fragmentation, "% max\n");
+    print_number("  Failed allocations: ", result->failed, "\n");
+}
+
+static int replay_file(const char* path) {
+    unsigned long size;
+    uint8_t* data = (uint8_t*)host_read_file(path, &size);
+    if (!data) {
+        terminal_writestring(path);
+        terminal_writestring(": cannot read file\n");
+        return 1;
+    }
+
+    memory_trace_header_t* header = (memory_trace_header_t*)data;
+    if (size < sizeof(*header) || strncmp(header->magic, MEMORY_TRACE_MAGIC, 4) != 0 ||
+        header->version != MEMORY_TRACE_VERSION ||
+        size < sizeof(*header) + (size_t)header->count * sizeof(memory_trace_entry_t)) {
+        terminal_writestring(path);
+        terminal_writestring(": not a memtrace file\n");
+        host_free(data);
+        return 1;
+    }
+
+    replay_result_t result;
+    replay_trace((memory_trace_entry_t*)(header + 1), header->count, &result);
+    print_result(path, header->count, header->dropped, &result);
+
+    host_free(data);
+    return 0;
+}
+
+// A mixed workload for when no recorded trace is at hand: mostly small
+// objects, some buffers and the occasional page-sized block, with frees
+// and resizes interleaved
+static int replay_synthetic(void) {
+    memory_trace_entry_t* entries = (memory_trace_entry_t*)host_alloc(SYNTHETIC_OPS * sizeof(memory_trace_entry_t));
+    if (!entries) {
+        return 1;
+    }
+
+    uint8_t live[SYNTHETIC_SLOTS];
+    memset(live, 0, sizeof(live));
+    uint32_t seed = 12345;
+
+    for (uint32_t i = 0; i < SYNTHETIC_OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t random = seed >> 8;
+        uint32_t slot = random % SYNTHETIC_SLOTS;
+
+        uint32_t size;
+        uint32_t kind = (random >> 9) % 10;
+        if (kind < 7) {
+            size = 16 + (random >> 13) % 240;
+        } else if (kind < 9) {
+            size = 256 + (random >> 13) % 3840;
+        } else {
+            size = 4096 + (random >> 13) % 28672;
+        }
+
+        memory_trace_entry_t* entry = &entries[i];
+        memset(entry, 0, sizeof(*entry));
+        entry->timestamp = i;
+        entry->size = size;
+
+        if (!live[slot]) {
+            entry->op = MEMORY_TRACE_ALLOC;
+            entry->id = slot + 1;
+            entry->align = ((random >> 4) % 8 == 0) ? MEMORY_CACHE_LINE_SIZE : 0;
+            live[slot] = 1;
+        } else if ((random >> 4) % 4 == 0) {
+            entry->op = MEMORY_TRACE_REALLOC;
+            entry->old_id = slot + 1;
+            entry->id = slot + 1;
+        } else {
+            entry->op = MEMORY_TRACE_FREE;
+            entry->id = slot + 1;
+            entry->size = 0;
+            live[slot] = 0;
+        }
+    }
+
+    replay_result_t result;
+    replay_trace(entries, SYNTHETIC_OPS, &result);
+    print_result("synthetic", SYNTHETIC_OPS, 0, &result);
+
+    host_free(entries);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        terminal_writestring("Usage: heapreplay <trace file>... | --synthetic\n");
+        terminal_writestring("Replays traces saved with 'memtrace dump' against the kernel allocator.\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--synthetic") == 0) {
+            status |= replay_synthetic();
+        } else {
+            status |= replay_file(argv[i]);
+        }
+    }
+    return status;
+}